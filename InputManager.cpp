@@ -18,34 +18,57 @@ InputManager::InputManager(Game* game)
       isRotating_(false),
       mouseX_(0.0f),
       mouseY_(0.0f),
+      mouseTimestamp_(0),
       dragStartX_(0.0f),
       dragStartY_(0.0f),
       initialOffsetX_(0.0f),
       initialOffsetY_(0.0f),
       initialRotation_(0.0f),
       draggedAppendage_(nullptr),
+      panning_(false),
+      layoutVersion_(0),
       currentMode_(EditMode::TORSO),
       currentShape_(Shape::TRIANGLE)
 {
+    layoutButtons(Game::SCREEN_WIDTH, Game::SCREEN_HEIGHT);
+    game_->logDebug("InputManager initialized, player_=%p\n", player_);
+}
+
+void InputManager::layoutButtons(int windowW, int windowH)
+{
+    (void)windowH;
     shapeButtons_ = {
         {{10, 50, 40, 40}, Shape::RECTANGLE, {255, 0, 0, 255}},
         {{10, 100, 40, 40}, Shape::CIRCLE, {0, 255, 0, 255}},
         {{10, 150, 40, 40}, Shape::TRIANGLE, {0, 0, 255, 255}}
     };
+    // Edit mode buttons stick to the right edge of the window
+    float right = (float)windowW - 50;
     editModeButtons_ = {
-        {{Game::SCREEN_WIDTH - 50, 10, 40, 40}, EditMode::TORSO, {200, 200, 200, 255}},
-        {{Game::SCREEN_WIDTH - 50, 60, 40, 40}, EditMode::APPENDAGE, {150, 150, 150, 255}},
-        {{Game::SCREEN_WIDTH - 50, 110, 40, 40}, EditMode::HANDS_FEET, {100, 100, 100, 255}}
+        {{right, 10, 40, 40}, EditMode::TORSO, {200, 200, 200, 255}},
+        {{right, 60, 40, 40}, EditMode::APPENDAGE, {150, 150, 150, 255}},
+        {{right, 110, 40, 40}, EditMode::HANDS_FEET, {100, 100, 100, 255}}
     };
     addNodeBtn_ = {{10, 200, 40, 40}, Shape::RECTANGLE, {255, 255, 0, 255}};
     removeNodeBtn_ = {{10, 250, 40, 40}, Shape::RECTANGLE, {255, 0, 255, 255}};
-    game_->logDebug("InputManager initialized, player_=%p\n", player_);
+    ++layoutVersion_;
+}
+
+float InputManager::getMouseWorldX() const
+{
+    return game_->getCamera().screenToWorld(mouseX_, mouseY_).x;
+}
+
+float InputManager::getMouseWorldY() const
+{
+    return game_->getCamera().screenToWorld(mouseX_, mouseY_).y;
 }
 
 void InputManager::handleQuitEvent()
 {
-    SDL_Quit();
-    exit(0);
+    // Game::run stops after this step, the game's destructor closes the input log and
+    // saves the scene
+    quitRequested_ = true;
 }
 
 void InputManager::handleKeyDownEvent(const SDL_KeyboardEvent& key)
@@ -58,10 +81,13 @@ void InputManager::handleKeyDownEvent(const SDL_KeyboardEvent& key)
     if (key.key == SDLK_TAB && !pressedTab_) {
         inventoryOpen_ = !inventoryOpen_;
         pressedTab_ = true;
+        game_->setEditing(inventoryOpen_);
         game_->logDebug("Inventory toggled: %s\n", inventoryOpen_ ? "open" : "closed");
     } else if (key.key == SDLK_1 && inventoryOpen_ && currentMode_ != EditMode::HANDS_FEET) {
-        game_->logDebug("Attempting to remove node at x=%.2f, y=%.2f\n", mouseX_, mouseY_);
-        removeNodeFromEntity(player_, mouseX_, mouseY_);
+        float worldX = getMouseWorldX();
+        float worldY = getMouseWorldY();
+        game_->logDebug("Attempting to remove node at x=%.2f, y=%.2f\n", worldX, worldY);
+        game_->removeNodeAt(worldX, worldY);
     } else if (key.key == SDLK_A && !inventoryOpen_) {
         movingLeft_ = true;
         movingRight_ = false;
@@ -70,6 +96,19 @@ void InputManager::handleKeyDownEvent(const SDL_KeyboardEvent& key)
         movingRight_ = true;
         movingLeft_ = false;
         game_->logDebug("Moving right\n");
+    } else if (key.key == SDLK_C && !inventoryOpen_ && !key.repeat) {
+        game_->setSpriteCacheEnabled(!game_->isSpriteCacheEnabled());
+    } else if (key.key == SDLK_F && !key.repeat) {
+        game_->setCameraFollow(true);
+        game_->logDebug("Camera follows player\n");
+    } else if (key.key == SDLK_F9 && !key.repeat) {
+        game_->toggleRecording();
+    } else if (key.key == SDLK_M && !key.repeat) {
+        game_->setMinimapEnabled(!game_->isMinimapEnabled());
+    } else if (key.key == SDLK_L && inventoryOpen_ && !key.repeat && !leftMouseHeld_) {
+        game_->loadNextDesign();
+    } else if (key.key == SDLK_G && !inventoryOpen_ && !key.repeat) {
+        game_->spawnCrowd(10);
     }
         if (key.key == SDLK_SPACE && !inventoryOpen_ && !pressedSpace_) {
         jumpRequested_ = true;
@@ -103,64 +142,78 @@ void InputManager::handleMouseButtonDown(const SDL_MouseButtonEvent& button)
 {
     mouseX_ = button.x;
     mouseY_ = button.y;
+    mouseTimestamp_ = button.timestamp;
     game_->logDebug("Mouse down at x=%.2f, y=%.2f, button=%d, inventoryOpen=%d\n", mouseX_, mouseY_, button.button, inventoryOpen_);
 
     if (button.button == SDL_BUTTON_LEFT) {
         leftMouseHeld_ = true;   // <- track state
     }
+    if (button.button == SDL_BUTTON_MIDDLE) {
+        panning_ = true;
+        game_->setCameraFollow(false);
+        return;
+    }
+
+    // Buttons are hit-tested in screen space, everything else in world space
+    float worldX = getMouseWorldX();
+    float worldY = getMouseWorldY();
 
     if (button.button == SDL_BUTTON_LEFT && inventoryOpen_) {
         if (!handleButtonClick(mouseX_, mouseY_)) {
             if (currentMode_ != EditMode::HANDS_FEET && placingNode_) {
-                game_->logDebug("Attempting to add node at x=%.2f, y=%.2f\n", mouseX_, mouseY_);
-                addNodeToEntity(player_, mouseX_, mouseY_);
+                game_->logDebug("Attempting to add node at x=%.2f, y=%.2f\n", worldX, worldY);
+                addNodeToEntity(player_, worldX, worldY);
+                game_->invalidateEditBvh();
                 placingNode_ = false;
                 game_->logDebug("Node placement attempted, placingNode reset\n");
             } else if (currentMode_ != EditMode::HANDS_FEET && removingNode_) {
-                game_->logDebug("Attempting to remove node at x=%.2f, y=%.2f\n", mouseX_, mouseY_);
-                removeNodeFromEntity(player_, mouseX_, mouseY_);
+                game_->logDebug("Attempting to remove node at x=%.2f, y=%.2f\n", worldX, worldY);
+                game_->removeNodeAt(worldX, worldY);
                 removingNode_ = false;
                 game_->logDebug("Node removal attempted, removingNode reset\n");
             } else if ((currentMode_ == EditMode::APPENDAGE || currentMode_ == EditMode::HANDS_FEET) && shapeSelectedForAppendage_) {
                 int nodeIndex;
                 Entity* parentEntity;
                 bool isHandOrFoot = (currentMode_ == EditMode::HANDS_FEET);
-                if (game_->addAppendageToEntity(player_, mouseX_, mouseY_, currentShape_, nodeIndex, parentEntity, isHandOrFoot)) {
+                if (game_->addAppendageAt(worldX, worldY, currentShape_, nodeIndex, parentEntity, isHandOrFoot)) {
                     shapeSelectedForAppendage_ = false;
                     updateAppendagePositions(player_);
                     game_->logDebug("Added %s appendage at node %d\n", isHandOrFoot ? "hand/foot" : "regular", nodeIndex);
                 } else {
-                    game_->logDebug("No node clicked for appendage at x=%.2f, y=%.2f\n", mouseX_, mouseY_);
+                    game_->logDebug("No node clicked for appendage at x=%.2f, y=%.2f\n", worldX, worldY);
                 }
             } else if (currentMode_ != EditMode::HANDS_FEET) {
-                draggedAppendage_ = findAppendageAtPoint(player_, mouseX_, mouseY_);
+                draggedAppendage_ = game_->pickAppendage(worldX, worldY);
                 if (draggedAppendage_) {
-                    dragStartX_ = mouseX_;
-                    dragStartY_ = mouseY_;
+                    dragStartX_ = worldX;
+                    dragStartY_ = worldY;
                     initialOffsetX_ = draggedAppendage_->offsetX;
                     initialOffsetY_ = draggedAppendage_->offsetY;
-                    game_->logDebug("Started dragging appendage at x=%.2f, y=%.2f\n", mouseX_, mouseY_);
+                    game_->logDebug("Started dragging appendage at x=%.2f, y=%.2f\n", worldX, worldY);
                 } else {
-                    game_->logDebug("No appendage found for dragging at x=%.2f, y=%.2f\n", mouseX_, mouseY_);
+                    game_->logDebug("No appendage found for dragging at x=%.2f, y=%.2f\n", worldX, worldY);
                 }
             }
         }
     } else if (button.button == SDL_BUTTON_RIGHT && inventoryOpen_ && !shapeSelectedForAppendage_ && !placingNode_ && !removingNode_) {
-        draggedAppendage_ = findAppendageAtPoint(player_, mouseX_, mouseY_);
+        draggedAppendage_ = game_->pickAppendage(worldX, worldY);
         if (draggedAppendage_) {
             isRotating_ = true;
-            dragStartX_ = mouseX_;
-            dragStartY_ = mouseY_;
+            dragStartX_ = worldX;
+            dragStartY_ = worldY;
             initialRotation_ = draggedAppendage_->rotation;
-            game_->logDebug("Started rotating appendage at x=%.2f, y=%.2f\n", mouseX_, mouseY_);
+            game_->logDebug("Started rotating appendage at x=%.2f, y=%.2f\n", worldX, worldY);
         } else {
-            game_->logDebug("No appendage found for rotating at x=%.2f, y=%.2f\n", mouseX_, mouseY_);
+            game_->logDebug("No appendage found for rotating at x=%.2f, y=%.2f\n", worldX, worldY);
         }
     }
 }
 
 void InputManager::handleMouseButtonUp(const SDL_MouseButtonEvent& button)
 {
+    if (button.button == SDL_BUTTON_MIDDLE) {
+        panning_ = false;
+    }
     if (button.button == SDL_BUTTON_LEFT) {
         leftMouseHeld_ = false;   // <- release
         if (draggedAppendage_) {
@@ -181,28 +234,74 @@ void InputManager::handleMouseButtonUp(const SDL_MouseButtonEvent& button)
 void InputManager::handleMouseMotion(const SDL_MouseMotionEvent& motion) {
     mouseX_ = motion.x;
     mouseY_ = motion.y;
+    mouseTimestamp_ = motion.timestamp;
+    if (panning_) {
+        Camera& camera = game_->getCamera();
+        camera.pan(-motion.xrel / camera.getZoom(), -motion.yrel / camera.getZoom());
+        return;
+    }
     if (draggedAppendage_ && inventoryOpen_) {
+        if (motion.state & SDL_BUTTON_LMASK) {
+            queueEdit(EditCommand::DRAG, getMouseWorldX(), getMouseWorldY());
+        } else if (motion.state & SDL_BUTTON_RMASK && isRotating_) {
+            queueEdit(EditCommand::ROTATE, getMouseWorldX(), getMouseWorldY());
+        }
+    }
+}
+
+// Drag and rotate targets are absolute (relative to where the gesture started), so
+// the last one of a frame gives the same result as applying all of them
+void InputManager::queueEdit(EditCommand::Kind kind, float worldX, float worldY)
+{
+    for (EditCommand& edit : pendingEdits_) {
+        if (edit.kind == kind && edit.appendage == draggedAppendage_) {
+            edit.worldX = worldX;
+            edit.worldY = worldY;
+            return;
+        }
+    }
+    pendingEdits_.push_back({kind, draggedAppendage_, worldX, worldY});
+}
+
+void InputManager::applyEdits()
+{
+    if (pendingEdits_.empty()) return;
+    for (const EditCommand& edit : pendingEdits_) {
+        Entity* appendage = edit.appendage;
         float nodeX = 0.0f, nodeY = 0.0f;
-        if (!game_->findParentNodePosition(draggedAppendage_, nodeX, nodeY)) {
+        if (!game_->findParentNodePosition(appendage, nodeX, nodeY)) {
             game_->logDebug("Failed to find parent node for dragged appendage\n");
-            return;
+            continue;
         }
-        if (motion.state & SDL_BUTTON_LMASK) {
-            float dx = mouseX_ - nodeX;
-            float dy = mouseY_ - nodeY;
-            draggedAppendage_->offsetX = dx * cos(-draggedAppendage_->rotation) - dy * sin(-draggedAppendage_->rotation);
-            draggedAppendage_->offsetY = dx * sin(-draggedAppendage_->rotation) + dy * cos(-draggedAppendage_->rotation);
-            updateAppendagePositions(player_);
-            game_->logDebug("Dragging appendage: offsetX=%.2f, offsetY=%.2f\n", draggedAppendage_->offsetX, draggedAppendage_->offsetY);
-        } else if (motion.state & SDL_BUTTON_RMASK && isRotating_) {
+        if (edit.kind == EditCommand::DRAG) {
+            float dx = edit.worldX - nodeX;
+            float dy = edit.worldY - nodeY;
+            appendage->offsetX = dx * cos(-appendage->rotation) - dy * sin(-appendage->rotation);
+            appendage->offsetY = dx * sin(-appendage->rotation) + dy * cos(-appendage->rotation);
+            game_->logDebug("Dragging appendage: offsetX=%.2f, offsetY=%.2f\n", appendage->offsetX, appendage->offsetY);
+        } else {
             float initialAngle = game_->angleToPoint(nodeX, nodeY, dragStartX_, dragStartY_);
-            float newAngle = game_->angleToPoint(nodeX, nodeY, mouseX_, mouseY_);
-            draggedAppendage_->rotation = initialRotation_ + (newAngle - initialAngle);
-            updateAppendagePositions(player_);
+            float newAngle = game_->angleToPoint(nodeX, nodeY, edit.worldX, edit.worldY);
+            appendage->rotation = initialRotation_ + (newAngle - initialAngle);
             game_->logDebug("Rotating appendage: initialAngle=%.2f, newAngle=%.2f, rotation=%.2f\n",
-                            initialAngle, newAngle, draggedAppendage_->rotation);
+                            initialAngle, newAngle, appendage->rotation);
         }
+        appendage->spriteDirty = true;
+    }
+    updateAppendagePositions(player_);
+    // Only the edited subtrees moved
+    for (const EditCommand& edit : pendingEdits_) {
+        game_->refitEditBvh(edit.appendage);
     }
+    pendingEdits_.clear();
+}
+
+void InputManager::handleMouseWheel(const SDL_MouseWheelEvent& wheel)
+{
+    if (wheel.y == 0.0f) return;
+    float factor = wheel.y > 0 ? 1.1f : 1.0f / 1.1f;
+    game_->getCamera().zoomAt(factor, wheel.mouse_x, wheel.mouse_y);
+    game_->logDebug("Zoom: %.2f\n", game_->getCamera().getZoom());
 }
 
 bool InputManager::handleButtonClick(float x, float y)
@@ -230,6 +329,7 @@ bool InputManager::handleButtonClick(float x, float y)
                 switchShape(player_, btn.shapeType);
                 currentShape_ = btn.shapeType; // Restore currentShape_ update
                 updateAppendagePositions(player_);
+                game_->invalidateEditBvh();
                 game_->logDebug("Switched player shape to %d\n", btn.shapeType);
             } else if (currentMode_ == EditMode::APPENDAGE || currentMode_ == EditMode::HANDS_FEET) {
                 currentShape_ = btn.shapeType;
@@ -276,29 +376,81 @@ bool InputManager::handleButtonClick(float x, float y)
     return false;
 }
 
-void InputManager::handleEvents()
+bool InputManager::queueEvent(const SDL_Event& event)
+{
+    if (!queue_.push(event)) {
+        game_->logDebug("Input queue full, dropped event %u\n", event.type);
+        return false;
+    }
+    return true;
+}
+
+int InputManager::handleEvents()
+{
+    // With the ring full the rest stays in SDL's queue until the next frame, dropping
+    // a key or button release would leave it held
+    SDL_Event event;
+    int count = 0;
+    while (!queue_.full() && SDL_PollEvent(&event)) {
+        queueEvent(event);
+        ++count;
+    }
+    return count;
+}
+
+int InputManager::waitEvents(Sint32 timeoutMs)
+{
+    // Only waits, the event stays in SDL's queue for handleEvents
+    if (!SDL_WaitEventTimeout(nullptr, timeoutMs)) return 0;
+    return handleEvents();
+}
+
+void InputManager::processEvents(Uint64 until)
 {
     SDL_Event event;
-    while (SDL_PollEvent(&event)) {
-        switch (event.type) {
-            case SDL_EVENT_QUIT:
-                handleQuitEvent();
-                break;
-            case SDL_EVENT_KEY_DOWN:
-                handleKeyDownEvent(event.key);
-                break;
-            case SDL_EVENT_KEY_UP:
-                handleKeyUpEvent(event.key);
-                break;
-            case SDL_EVENT_MOUSE_BUTTON_DOWN:
-                handleMouseButtonDown(event.button);
-                break;
-            case SDL_EVENT_MOUSE_BUTTON_UP:
-                handleMouseButtonUp(event.button);
-                break;
-            case SDL_EVENT_MOUSE_MOTION:
-                handleMouseMotion(event.motion);
-                break;
+    while (!quitRequested_ && queue_.popUntil(until, event)) {
+        if (inputLog_) {
+            inputLog_->write(game_->getSimStep(), event);
         }
+        handleEvent(event);
+    }
+    applyEdits();
+}
+
+void InputManager::handleEvent(const SDL_Event& event)
+{
+    // Queued edits go first when anything else happens, which could change the tree
+    // or end the gesture they belong to
+    if (event.type != SDL_EVENT_MOUSE_MOTION) {
+        applyEdits();
+    }
+    switch (event.type) {
+        case SDL_EVENT_QUIT:
+            handleQuitEvent();
+            break;
+        case SDL_EVENT_KEY_DOWN:
+            handleKeyDownEvent(event.key);
+            break;
+        case SDL_EVENT_KEY_UP:
+            handleKeyUpEvent(event.key);
+            break;
+        case SDL_EVENT_MOUSE_BUTTON_DOWN:
+            handleMouseButtonDown(event.button);
+            break;
+        case SDL_EVENT_MOUSE_BUTTON_UP:
+            handleMouseButtonUp(event.button);
+            break;
+        case SDL_EVENT_MOUSE_MOTION:
+            handleMouseMotion(event.motion);
+            break;
+        case SDL_EVENT_MOUSE_WHEEL:
+            handleMouseWheel(event.wheel);
+            break;
+        case SDL_EVENT_WINDOW_RESIZED:
+            game_->onWindowResized(event.window.data1, event.window.data2);
+            break;
+        case SDL_EVENT_WINDOW_DISPLAY_CHANGED:
+            game_->updateRefreshRate();
+            break;
     }
 }
\ No newline at end of file
@@ -4,13 +4,25 @@
 #include <SDL3/SDL.h>
 #include <vector>
 #include "entity.h"
+#include "inputqueue.h"
+#include "inputlog.h"
 
 class Game;
 
 class InputManager {
 public:
     InputManager(Game* game);
-    void handleEvents();
+    // Moves SDL's pending events into the input queue while it has room, returns how many
+    int handleEvents();
+    // Blocks until an event arrives or timeoutMs passes, then queues everything pending
+    int waitEvents(Sint32 timeoutMs);
+    // Handles the queued events up to the given SDL_GetTicksNS time, once per
+    // simulation step with the step's end time
+    void processEvents(Uint64 until);
+    // Handled events are written here, tagged with the game's simulation step
+    void setInputLog(InputLog* log) { inputLog_ = log; }
+    // Replay: queues an event from a log, processEvents handles it like a real one
+    void queueReplayEvent(const SDL_Event& event) { queueEvent(event); }
     Entity* getPlayer() { return player_; }
     
     enum class EditMode { TORSO, APPENDAGE, HANDS_FEET };
@@ -41,7 +53,14 @@ public:
     bool getIsRotating() const { return isRotating_; }
     float getMouseX() const { return mouseX_; }
     float getMouseY() const { return mouseY_; }
+    // SDL timestamp (ns) of the event mouseX_/mouseY_ come from
+    Uint64 getMouseTimestamp() const { return mouseTimestamp_; }
+    // Mouse position in world space, through the game's camera
+    float getMouseWorldX() const;
+    float getMouseWorldY() const;
     Entity* getDraggedAppendage() const { return draggedAppendage_; }
+    // The window was closed, later events are not handled
+    bool isQuitRequested() const { return quitRequested_; }
 
     EditMode getCurrentMode() const { return currentMode_; }
     Shape getCurrentShape() const { return currentShape_; }
@@ -49,10 +68,14 @@ public:
     const std::vector<EditModeButton>& getEditModeButtons() const { return editModeButtons_; }
     const ShapeButton& getAddNodeButton() const { return addNodeBtn_; }
     const ShapeButton& getRemoveNodeButton() const { return removeNodeBtn_; }
+    // Places the buttons for the given window size, bumps the layout version
+    void layoutButtons(int windowW, int windowH);
+    int getLayoutVersion() const { return layoutVersion_; }
 
 private:
 
     bool leftMouseHeld_ = false;
+    bool quitRequested_ = false;
     Game* game_;
     Entity* player_; // Removed duplicate 'player'
     bool pressedTab_;
@@ -67,22 +90,42 @@ private:
     bool removingNode_;
     bool isRotating_;
     float mouseX_, mouseY_;
+    Uint64 mouseTimestamp_;
     float dragStartX_, dragStartY_;
     float initialOffsetX_, initialOffsetY_;
     float initialRotation_;
     Entity* draggedAppendage_;
+    bool panning_;
+    int layoutVersion_;
+
+    // Drag/rotate edits from mouse motion. Only the last target per appendage is kept,
+    // they are applied with a single hierarchy update per frame.
+    struct EditCommand {
+        enum Kind { DRAG, ROTATE };
+        Kind kind;
+        Entity* appendage;
+        float worldX, worldY; // mouse in world space when the event arrived
+    };
+    std::vector<EditCommand> pendingEdits_;
+    InputQueue queue_;
+    InputLog* inputLog_ = nullptr;
     
     std::vector<ShapeButton> shapeButtons_;
     std::vector<EditModeButton> editModeButtons_;
     ShapeButton addNodeBtn_;
     ShapeButton removeNodeBtn_;
 
+    void handleEvent(const SDL_Event& event);
+    bool queueEvent(const SDL_Event& event);
+    void queueEdit(EditCommand::Kind kind, float worldX, float worldY);
+    void applyEdits();
     void handleQuitEvent();
     void handleKeyDownEvent(const SDL_KeyboardEvent& key);
     void handleKeyUpEvent(const SDL_KeyboardEvent& key);
     void handleMouseButtonDown(const SDL_MouseButtonEvent& button);
     void handleMouseButtonUp(const SDL_MouseButtonEvent& button);
     void handleMouseMotion(const SDL_MouseMotionEvent& motion);
+    void handleMouseWheel(const SDL_MouseWheelEvent& wheel);
     bool handleButtonClick(float x, float y);
 };
 
@@ -0,0 +1,231 @@
+#include "bakedcreature.h"
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+CreatureBlueprint::CreatureBlueprint(const Entity* root) {
+    addPart(root, -1, -1, ATTACHED);
+
+    // Children of each part next to each other, in appendage order
+    for (const Part& part : parts_) {
+        if (part.parent >= 0) ++parts_[part.parent].childCount;
+    }
+    Uint32 offset = 0;
+    for (Part& part : parts_) {
+        part.firstChild = offset;
+        offset += part.childCount;
+        part.childCount = 0;
+    }
+    children_.resize(offset);
+    for (Uint32 i = 1; i < (Uint32)parts_.size(); ++i) {
+        Part& parent = parts_[parts_[i].parent];
+        children_[parent.firstChild + parent.childCount++] = i;
+    }
+}
+
+void CreatureBlueprint::addPart(const Entity* entity, Sint32 parent, Sint32 node, Uint8 inherited) {
+    int index = (int)parts_.size();
+    Uint8 flags = inherited;
+    if (parent >= 0) {
+        if (node < 0) flags &= ~ATTACHED;
+        if (entity->isHandOrFoot) {
+            if (!(flags & DYNAMIC)) flags |= DYNAMIC_ROOT;
+            flags |= DYNAMIC | HAND_OR_FOOT;
+            if (entity->isLeg) {
+                flags |= LEG;
+                feet_.push_back(index);
+            }
+            if (entity->shapetype == Shape::TRIANGLE) {
+                flags |= STEERED_HAND;
+                hands_.push_back(index);
+            }
+        }
+    }
+
+    Part part = {};
+    part.parent = parent;
+    part.node = node;
+    part.firstNode = (Uint32)nodeOffsets_.size();
+    part.nodeCount = (Uint32)entity->nodeCount;
+    part.width = (float)entity->width;
+    part.height = (float)entity->height;
+    part.boundsRadius = 0.5f * std::sqrt(2.0f) * std::max(entity->width, entity->height);
+    part.shape = entity->shapetype;
+    part.color = entity->isHandOrFoot ? SDL_Color{255, 255, 0, 255} : entity->color;
+    part.flags = flags;
+    parts_.push_back(part);
+    restPose_.push_back({entity->Xpos, entity->Ypos, entity->rotation, entity->offsetX, entity->offsetY});
+    for (int i = 0; i < entity->nodeCount; ++i) {
+        nodeOffsets_.push_back({entity->nodesRel[i].x_rel * (entity->width / 2.0f),
+                                entity->nodesRel[i].y_rel * (entity->height / 2.0f)});
+    }
+
+    Uint8 inheritedByChildren = flags & (ATTACHED | DYNAMIC);
+    for (const auto& app : entity->appendages) {
+        addPart(app.get(), index, findNodeIndex(entity, app->coreNodeIndex), inheritedByChildren);
+    }
+}
+
+size_t CreatureBlueprint::getMemoryUsage() const {
+    return sizeof(*this) + parts_.capacity() * sizeof(Part) + nodeOffsets_.capacity() * sizeof(NodeRel) +
+           children_.capacity() * sizeof(Uint32) + (feet_.capacity() + hands_.capacity()) * sizeof(int) +
+           restPose_.capacity() * sizeof(CreaturePose);
+}
+
+SDL_FPoint CreatureBlueprint::getNode(const CreaturePose* poses, int part, int node) const {
+    const CreaturePose& pose = poses[part];
+    const NodeRel& offset = nodeOffsets_[parts_[part].firstNode + node];
+    // Double like relativeToAbsolute, so the tree and the blueprint agree to the bit
+    double c = std::cos((double)pose.rotation);
+    double s = std::sin((double)pose.rotation);
+    return {(float)(pose.x + offset.x_rel * c - offset.y_rel * s), (float)(pose.y + offset.x_rel * s + offset.y_rel * c)};
+}
+
+bool CreatureBlueprint::getAttachPoint(const CreaturePose* poses, int index, SDL_FPoint& point) const {
+    const Part& part = parts_[index];
+    if (part.parent < 0) return false;
+    if (part.node < 0 || part.node >= (Sint32)parts_[part.parent].nodeCount) return false;
+    point = getNode(poses, part.parent, part.node);
+    return true;
+}
+
+void CreatureBlueprint::updatePose(CreaturePose* poses) const {
+    for (int i = 1; i < (int)parts_.size(); ++i) {
+        const Part& part = parts_[i];
+        if (!(part.flags & ATTACHED)) continue;
+        SDL_FPoint node = getNode(poses, part.parent, part.node);
+        float rot = poses[part.parent].rotation;
+        double c = std::cos((double)rot);
+        double s = std::sin((double)rot);
+        CreaturePose& pose = poses[i];
+        pose.x = (float)(node.x + pose.offsetX * c - pose.offsetY * s);
+        pose.y = (float)(node.y + pose.offsetX * s + pose.offsetY * c);
+        pose.rotation = rot;
+    }
+}
+
+float CreatureBlueprint::getLowestY(const CreaturePose* poses) const {
+    float lowestY = std::numeric_limits<float>::lowest();
+    for (size_t i = 0; i < parts_.size(); ++i) {
+        lowestY = std::max(lowestY, poses[i].y + parts_[i].height / 2.0f);
+    }
+    return lowestY;
+}
+
+void CreatureBlueprint::getMinMaxX(const CreaturePose* poses, float& minX, float& maxX) const {
+    for (size_t i = 0; i < parts_.size(); ++i) {
+        float hw = parts_[i].width / 2.0f;
+        double c = std::cos((double)poses[i].rotation);
+        double s = std::sin((double)poses[i].rotation);
+        // Corners of the width x width square, rotated
+        const SDL_FPoint points[4] = {{-hw, -hw}, {hw, -hw}, {hw, hw}, {-hw, hw}};
+        for (const SDL_FPoint& p : points) {
+            float x = poses[i].x + (float)(p.x * c - p.y * s);
+            minX = std::min(minX, x);
+            maxX = std::max(maxX, x);
+        }
+    }
+}
+
+SDL_FRect CreatureBlueprint::getBounds(const CreaturePose* poses) const {
+    float minX = std::numeric_limits<float>::max(), minY = minX;
+    float maxX = std::numeric_limits<float>::lowest(), maxY = maxX;
+    for (int i = 0; i < (int)parts_.size(); ++i) {
+        const CreaturePose& pose = poses[i];
+        float r = parts_[i].boundsRadius;
+        minX = std::min(minX, pose.x - r);
+        minY = std::min(minY, pose.y - r);
+        maxX = std::max(maxX, pose.x + r);
+        maxY = std::max(maxY, pose.y + r);
+        for (Uint32 n = 0; n < parts_[i].nodeCount; ++n) {
+            SDL_FPoint node = getNode(poses, i, (int)n);
+            minX = std::min(minX, node.x - 3.0f);
+            minY = std::min(minY, node.y - 3.0f);
+            maxX = std::max(maxX, node.x + 3.0f);
+            maxY = std::max(maxY, node.y + 3.0f);
+        }
+    }
+    return {minX, minY, maxX - minX, maxY - minY};
+}
+
+// The design's rest pose moved so its root is at x, y
+void CreatureInstance::spawn(std::shared_ptr<const CreatureBlueprint> design, float x, float y) {
+    blueprint = std::move(design);
+    poses = blueprint->getRestPose();
+    float dx = x - poses[0].x;
+    float dy = y - poses[0].y;
+    for (CreaturePose& pose : poses) {
+        pose.x += dx;
+        pose.y += dy;
+    }
+    hands.assign(blueprint->getSteeredHands().size(), {false, nullptr});
+    xvel = 0.0f;
+    yvel = 0.0f;
+    onGround = false;
+}
+
+size_t CreatureInstance::getMemoryUsage() const {
+    return sizeof(*this) + poses.capacity() * sizeof(CreaturePose) + hands.capacity() * sizeof(CreatureHand);
+}
+
+void BakedCreature::clear() {
+    root_ = nullptr;
+    entities_.clear();
+    instance_ = CreatureInstance();
+}
+
+void BakedCreature::bake(Entity* root) {
+    clear();
+    if (!root) return;
+    root_ = root;
+    collectEntities(root);
+    instance_.blueprint = std::make_shared<const CreatureBlueprint>(root);
+    instance_.poses = instance_.blueprint->getRestPose();
+    const std::vector<int>& hands = instance_.blueprint->getSteeredHands();
+    for (int hand : hands) {
+        instance_.hands.push_back({entities_[hand]->grabbing, entities_[hand]->grabbedObject});
+    }
+}
+
+void BakedCreature::collectEntities(Entity* entity) {
+    entities_.push_back(entity);
+    for (auto& app : entity->appendages) {
+        collectEntities(app.get());
+    }
+}
+
+void BakedCreature::writeBack() {
+    const CreatureBlueprint& blueprint = *instance_.blueprint;
+    const CreaturePose* poses = getPoses();
+    for (int i = 0; i < (int)entities_.size(); ++i) {
+        Entity* entity = entities_[i];
+        if (i > 0) {
+            entity->Xpos = poses[i].x;
+            entity->Ypos = poses[i].y;
+            entity->rotation = poses[i].rotation;
+            entity->offsetX = poses[i].offsetX;
+            entity->offsetY = poses[i].offsetY;
+        }
+        for (Uint32 n = 0; n < blueprint.getPart(i).nodeCount; ++n) {
+            SDL_FPoint node = blueprint.getNode(poses, i, (int)n);
+            entity->nodes[n] = {node.x, node.y};
+        }
+    }
+    const std::vector<int>& hands = blueprint.getSteeredHands();
+    for (size_t slot = 0; slot < hands.size(); ++slot) {
+        entities_[hands[slot]]->grabbing = instance_.hands[slot].grabbing;
+        entities_[hands[slot]]->grabbedObject = instance_.hands[slot].grabbedObject;
+    }
+}
+
+CreaturePose* BakedCreature::syncRoot() {
+    CreaturePose& root = instance_.poses[0];
+    root.x = root_->Xpos;
+    root.y = root_->Ypos;
+    root.rotation = root_->rotation;
+    return instance_.poses.data();
+}
+
+void BakedCreature::updatePose() {
+    instance_.blueprint->updatePose(syncRoot());
+}
@@ -0,0 +1,134 @@
+#ifndef BAKED_CREATURE_H
+#define BAKED_CREATURE_H
+
+#include <SDL3/SDL.h>
+#include <vector>
+#include <memory>
+#include "entity.h"
+
+// Simulated transform of one part. The offsets only change for steered hands.
+struct CreaturePose {
+    float x, y, rotation;
+    float offsetX, offsetY;
+};
+
+struct CreatureHand {
+    bool grabbing;
+    Entity* grabbedObject;
+};
+
+// Immutable design of a creature, compiled from an editable Entity tree: parts in
+// preorder (parents before children) with the hierarchy, node layout (relative
+// nodes already scaled to the part's size), drawn colors, bound radii and the
+// feet/hand lists. Shared by every creature built from the same design, each of
+// them only keeps a pose array (CreatureInstance).
+class CreatureBlueprint {
+public:
+    enum : Uint8 {
+        HAND_OR_FOOT = 1,
+        LEG = 2,
+        STEERED_HAND = 4,  // follows the pointer, see Game::updateHands
+        DYNAMIC = 8,       // hand/foot or below one: drawn every frame even with a cached sprite
+        DYNAMIC_ROOT = 16, // topmost part of a DYNAMIC subtree
+        ATTACHED = 32      // every ancestor hangs on a valid node, so the part follows its parent
+    };
+
+    struct Part {
+        Sint32 parent;       // -1 for the root
+        Sint32 node;         // node of the parent it hangs on
+        Uint32 firstNode, nodeCount;
+        Uint32 firstChild, childCount; // into children
+        float width, height;
+        float boundsRadius;  // getShapeBounds
+        Shape shape;
+        SDL_Color color;     // as drawn
+        Uint8 flags;
+    };
+
+    explicit CreatureBlueprint(const Entity* root);
+
+    int getPartCount() const { return (int)parts_.size(); }
+    const Part& getPart(int index) const { return parts_[index]; }
+    const Uint32* getChildren(int index) const { return children_.data() + parts_[index].firstChild; }
+    const std::vector<int>& getFeet() const { return feet_; }
+    const std::vector<int>& getSteeredHands() const { return hands_; }
+    // Pose of the tree it was built from
+    const std::vector<CreaturePose>& getRestPose() const { return restPose_; }
+    size_t getMemoryUsage() const;
+
+    // Everything below is derived from a pose array, poses[0] being the root transform
+    SDL_FPoint getNode(const CreaturePose* poses, int part, int node) const;
+    // Position of the node a part hangs on, false for the root or a missing node
+    bool getAttachPoint(const CreaturePose* poses, int part, SDL_FPoint& point) const;
+    // Same as updateAppendagePositions on the tree: every attached part from its parent's node
+    void updatePose(CreaturePose* poses) const;
+    // Same as Game's old tree walks: lowest shape edge, x extent, getEntityBounds
+    float getLowestY(const CreaturePose* poses) const;
+    void getMinMaxX(const CreaturePose* poses, float& minX, float& maxX) const;
+    SDL_FRect getBounds(const CreaturePose* poses) const;
+
+private:
+    std::vector<Part> parts_;
+    std::vector<NodeRel> nodeOffsets_; // nodesRel scaled by half width/height
+    std::vector<Uint32> children_;
+    std::vector<int> feet_, hands_;
+    std::vector<CreaturePose> restPose_;
+
+    // node: index of the parent's node the entity hangs on, -1 if none
+    void addPart(const Entity* entity, Sint32 parent, Sint32 node, Uint8 inherited);
+};
+
+// One creature built from a shared blueprint: root motion, the pose of every part
+// and the grab state of its hands
+struct CreatureInstance {
+    std::shared_ptr<const CreatureBlueprint> blueprint;
+    float xvel = 0.0f, yvel = 0.0f;
+    bool onGround = false;
+    std::vector<CreaturePose> poses; // poses[0] is the root transform
+    std::vector<CreatureHand> hands; // one per steered hand
+
+    void spawn(std::shared_ptr<const CreatureBlueprint> design, float x, float y);
+    size_t getMemoryUsage() const;
+};
+
+// Runtime form of the player, built when the editor closes. The root stays a live
+// Entity (physics moves it directly), the rest of the tree is a CreatureInstance
+// until the editor opens again and writeBack() puts its pose back into the tree.
+class BakedCreature {
+public:
+    void bake(Entity* root);
+    // Pose and hand state back into the tree, call before the tree is edited or read
+    void writeBack();
+    void clear();
+    bool isBaked() const { return root_ != nullptr; }
+    Entity* getRoot() const { return root_; }
+
+    const CreatureBlueprint& getBlueprint() const { return *instance_.blueprint; }
+    const std::shared_ptr<const CreatureBlueprint>& shareBlueprint() const { return instance_.blueprint; }
+    int getPartCount() const { return root_ ? instance_.blueprint->getPartCount() : 0; }
+    CreaturePose& getPose(int index) { return instance_.poses[index]; }
+    const CreaturePose& getPose(int index) const { return instance_.poses[index]; }
+    // Poses with the root's current transform
+    const CreaturePose* getPoses() { return syncRoot(); }
+    CreatureHand& getHand(int slot) { return instance_.hands[slot]; }
+    const std::vector<int>& getFeet() const { return instance_.blueprint->getFeet(); }
+    const std::vector<int>& getSteeredHands() const { return instance_.blueprint->getSteeredHands(); }
+    bool getAttachPoint(int index, SDL_FPoint& point) {
+        return instance_.blueprint->getAttachPoint(getPoses(), index, point);
+    }
+
+    void updatePose();
+    float getLowestY() { return instance_.blueprint->getLowestY(getPoses()); }
+    void getMinMaxX(float& minX, float& maxX) { instance_.blueprint->getMinMaxX(getPoses(), minX, maxX); }
+    SDL_FRect getBounds() { return instance_.blueprint->getBounds(getPoses()); }
+
+private:
+    Entity* root_ = nullptr;
+    std::vector<Entity*> entities_; // editable source of each part
+    CreatureInstance instance_;
+
+    void collectEntities(Entity* entity);
+    CreaturePose* syncRoot();
+};
+
+#endif // BAKED_CREATURE_H
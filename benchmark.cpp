@@ -0,0 +1,189 @@
+#include "benchmark.h"
+#include "Renderer.h"
+#include "softraster.h"
+#include "shapebatch.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+static constexpr int BENCH_WIDTH = 1280;
+static constexpr int BENCH_HEIGHT = 720;
+static constexpr int BENCH_CREATURES = 400;
+static constexpr int BENCH_SHAPES = 256; // Per shape type
+
+// Same kind of geometry the collectors emit: bodies, circles with 32 sides,
+// node markers, connection lines. Some shapes are translucent.
+static void buildBenchScene(RenderData& data) {
+    SDL_srand(1234);
+    for (int i = 0; i < BENCH_CREATURES; ++i) {
+        float cx = SDL_randf() * BENCH_WIDTH;
+        float cy = SDL_randf() * BENCH_HEIGHT;
+        float size = 20.0f + SDL_randf() * 60.0f;
+        SDL_FColor body = {SDL_randf(), SDL_randf(), SDL_randf(), i % 4 == 0 ? 0.5f : 1.0f};
+        SDL_FPoint corners[4] = {
+            {cx - size / 2, cy - size / 2}, {cx + size / 2, cy - size / 2},
+            {cx + size / 2, cy + size / 2}, {cx - size / 2, cy + size / 2}
+        };
+        emitQuad(data, corners, body);
+        for (int j = 0; j < 4; ++j) {
+            float angle = j * 1.5707963f + SDL_randf();
+            float ax = cx + std::cos(angle) * size;
+            float ay = cy + std::sin(angle) * size;
+            emitLine(data, cx, cy, ax, ay, 2.0f, {1.0f, 1.0f, 1.0f, 1.0f});
+            emitCircle(data, ax, ay, size / 3, 32, {SDL_randf(), SDL_randf(), SDL_randf(), 1.0f});
+            emitCircle(data, ax, ay, 3.0f, 8, {0.0f, 0.0f, 1.0f, 1.0f});
+        }
+        emitTriangle(data, {cx, cy - size}, {cx + size / 2, cy}, {cx - size / 2, cy}, {1.0f, 0.0f, 0.0f, 1.0f});
+    }
+}
+
+static double secondsSince(Uint64 start) {
+    return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+}
+
+static double benchSoftRasterizer(const RenderData& scene, int threads, int frames, std::vector<Uint32>* output) {
+    SoftRasterizer raster(threads);
+    raster.resize(BENCH_WIDTH, BENCH_HEIGHT);
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < frames; ++i) {
+        raster.clear({100, 100, 100, 255});
+        raster.draw(scene);
+        raster.finish();
+    }
+    double ms = secondsSince(start) * 1000.0 / frames;
+    printf("SoftRasterizer %2d thread(s), %-6s: %8.3f ms/frame\n", raster.getThreadCount(), raster.getSimdName(), ms);
+    if (output) {
+        output->assign(raster.getPixels(), raster.getPixels() + BENCH_WIDTH * BENCH_HEIGHT);
+    }
+    return ms;
+}
+
+int runRasterBenchmark(int frames) {
+    RenderData scene;
+    buildBenchScene(scene);
+    printf("Raster benchmark: %dx%d, %d triangles, %d frames\n",
+           BENCH_WIDTH, BENCH_HEIGHT, scene.indexCount() / 3, frames);
+
+    SDL_Surface* surface = SDL_CreateSurface(BENCH_WIDTH, BENCH_HEIGHT, SDL_PIXELFORMAT_ARGB8888);
+    if (!surface) {
+        printf("SDL_CreateSurface Error: %s\n", SDL_GetError());
+        return 1;
+    }
+    SDL_Renderer* sdlSoftware = SDL_CreateSoftwareRenderer(surface);
+    if (!sdlSoftware) {
+        printf("SDL_CreateSoftwareRenderer Error: %s\n", SDL_GetError());
+        SDL_DestroySurface(surface);
+        return 1;
+    }
+    Renderer renderer(sdlSoftware);
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < frames; ++i) {
+        renderer.clear({100, 100, 100, 255});
+        renderer.renderBatchedGeometry(scene);
+        SDL_FlushRenderer(sdlSoftware);
+    }
+    double sdlMs = secondsSince(start) * 1000.0 / frames;
+    printf("SDL software renderer           : %8.3f ms/frame\n", sdlMs);
+
+    std::vector<Uint32> pixels;
+    double singleMs = benchSoftRasterizer(scene, 1, frames, nullptr);
+    double multiMs = benchSoftRasterizer(scene, 0, frames, &pixels);
+    printf("Speedup vs SDL: %.2fx single thread, %.2fx all threads\n", sdlMs / singleMs, sdlMs / multiMs);
+
+    // Edge pixels may differ slightly (fill rule, rounding), count the ones that really differ
+    int different = 0;
+    for (int y = 0; y < BENCH_HEIGHT; ++y) {
+        const Uint32* row = (const Uint32*)((const Uint8*)surface->pixels + y * surface->pitch);
+        for (int x = 0; x < BENCH_WIDTH; ++x) {
+            Uint32 a = row[x];
+            Uint32 b = pixels[y * BENCH_WIDTH + x];
+            for (int shift = 0; shift < 24; shift += 8) {
+                if (std::abs((int)((a >> shift) & 0xFF) - (int)((b >> shift) & 0xFF)) > 2) {
+                    ++different;
+                    break;
+                }
+            }
+        }
+    }
+    printf("Pixels differing from SDL: %d (%.3f%%)\n", different, 100.0 * different / (BENCH_WIDTH * BENCH_HEIGHT));
+
+    SDL_DestroyRenderer(sdlSoftware);
+    SDL_DestroySurface(surface);
+    return 0;
+}
+
+// Distance from the point to the nearest edge of the shape is tiny: rounding decides
+static bool onShapeEdge(float px, float py, Entity* entity) {
+    const float nudge = 0.01f;
+    bool inside = pointInEntityShape(px, py, entity);
+    return pointInEntityShape(px + nudge, py, entity) != inside || pointInEntityShape(px - nudge, py, entity) != inside ||
+           pointInEntityShape(px, py + nudge, entity) != inside || pointInEntityShape(px, py - nudge, entity) != inside;
+}
+
+int runShapeBenchmark(int points) {
+    static const char* names[] = {"rectangle", "circle", "triangle"};
+    printf("Shape benchmark: %d points against %d shapes per type, %s kernels\n", points, BENCH_SHAPES,
+           getShapeBatchSimdName());
+    SDL_srand(4321);
+    std::vector<float> px(points), py(points);
+    for (int i = 0; i < points; ++i) {
+        px[i] = SDL_randf() * BENCH_WIDTH;
+        py[i] = SDL_randf() * BENCH_HEIGHT;
+    }
+    std::vector<int> expected(points), scalar(points), simd(points);
+    int failures = 0;
+    for (int type = RECTANGLE; type < SHAPE_COUNT; ++type) {
+        std::vector<Entity> shapes(BENCH_SHAPES);
+        ShapeBatch batch;
+        batch.clear((Shape)type);
+        for (Entity& shape : shapes) {
+            shape.shapetype = (Shape)type;
+            shape.Xpos = SDL_randf() * BENCH_WIDTH;
+            shape.Ypos = SDL_randf() * BENCH_HEIGHT;
+            shape.width = 10 + SDL_rand(60);
+            shape.height = 10 + SDL_rand(60);
+            shape.rotation = SDL_randf() * 6.2831853f;
+            batch.add(&shape);
+        }
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int p = 0; p < points; ++p) {
+            expected[p] = -1;
+            for (int i = 0; i < BENCH_SHAPES; ++i) {
+                if (pointInEntityShape(px[p], py[p], &shapes[i])) {
+                    expected[p] = i;
+                    break;
+                }
+            }
+        }
+        double entityNs = secondsSince(start) * 1e9 / points;
+        start = SDL_GetPerformanceCounter();
+        pointsInShapesScalar(batch, px.data(), py.data(), points, scalar.data());
+        double scalarNs = secondsSince(start) * 1e9 / points;
+        start = SDL_GetPerformanceCounter();
+        pointsInShapes(batch, px.data(), py.data(), points, simd.data());
+        double simdNs = secondsSince(start) * 1e9 / points;
+
+        int hits = 0, edge = 0, wrong = 0;
+        for (int p = 0; p < points; ++p) {
+            if (expected[p] >= 0) ++hits;
+            if (simd[p] == expected[p] && scalar[p] == expected[p]) continue;
+            // The first hit may only differ where one of the two shapes' edges runs through the point
+            int a = BENCH_SHAPES;
+            for (int hit : {expected[p], scalar[p], simd[p]}) {
+                if (hit >= 0) a = std::min(a, hit);
+            }
+            bool onEdge = a < BENCH_SHAPES && onShapeEdge(px[p], py[p], &shapes[a]);
+            if (onEdge) {
+                ++edge;
+            } else {
+                ++wrong;
+            }
+        }
+        printf("%-9s: pointInEntityShape %8.1f ns/point, scalar batch %8.1f ns, SIMD batch %8.1f ns (%.1fx), "
+               "%d hits, %d differ on an edge, %d wrong\n",
+               names[type], entityNs, scalarNs, simdNs, entityNs / simdNs, hits, edge, wrong);
+        failures += wrong;
+    }
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,14 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+// Renders a generated scene of creature-like shapes with SDL's software renderer and
+// with SoftRasterizer, prints the time per frame and how many pixels differ.
+int runRasterBenchmark(int frames);
+
+// Tests random points against batches of rotated rectangles, circles and triangles
+// with pointInEntityShape, the scalar batch loop and the SIMD batch kernels. Prints
+// the time per point and returns 1 if a batch result differs from pointInEntityShape
+// other than right on a shape's edge.
+int runShapeBenchmark(int points);
+
+#endif // BENCHMARK_H
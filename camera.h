@@ -0,0 +1,83 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <SDL3/SDL.h>
+#include <algorithm>
+
+// screen = world * scale + offset, applied by the renderer when submitting world geometry
+struct ViewTransform {
+    float scale = 1.0f;
+    float offsetX = 0.0f;
+    float offsetY = 0.0f;
+};
+
+inline bool rectsOverlap(const SDL_FRect& a, const SDL_FRect& b) {
+    return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+}
+
+// Maps world coordinates to a viewport of the window. The camera looks at center_
+// with the given zoom, the viewport is in screen pixels.
+class Camera {
+public:
+    static constexpr float MIN_ZOOM = 0.1f;
+    static constexpr float MAX_ZOOM = 4.0f;
+    static constexpr float NODE_MARKER_MIN_ZOOM = 0.5f; // Below this node markers are not drawn
+
+    Camera(int viewportW = 700, int viewportH = 700)
+        : centerX_(viewportW / 2.0f), centerY_(viewportH / 2.0f), zoom_(1.0f),
+          viewportW_(viewportW), viewportH_(viewportH) {}
+
+    void setViewport(int w, int h) {
+        viewportW_ = w;
+        viewportH_ = h;
+    }
+    int getViewportWidth() const { return viewportW_; }
+    int getViewportHeight() const { return viewportH_; }
+
+    void setCenter(float x, float y) {
+        centerX_ = x;
+        centerY_ = y;
+    }
+    float getCenterX() const { return centerX_; }
+    float getCenterY() const { return centerY_; }
+    void pan(float dx, float dy) {
+        centerX_ += dx;
+        centerY_ += dy;
+    }
+
+    void setZoom(float zoom) { zoom_ = std::clamp(zoom, MIN_ZOOM, MAX_ZOOM); }
+    float getZoom() const { return zoom_; }
+    // Zooms while keeping the world point under the given screen position in place
+    void zoomAt(float factor, float screenX, float screenY) {
+        SDL_FPoint before = screenToWorld(screenX, screenY);
+        setZoom(zoom_ * factor);
+        SDL_FPoint after = screenToWorld(screenX, screenY);
+        pan(before.x - after.x, before.y - after.y);
+    }
+
+    ViewTransform getViewTransform() const {
+        return {zoom_, viewportW_ / 2.0f - centerX_ * zoom_, viewportH_ / 2.0f - centerY_ * zoom_};
+    }
+    SDL_FPoint worldToScreen(float x, float y) const {
+        return {(x - centerX_) * zoom_ + viewportW_ / 2.0f, (y - centerY_) * zoom_ + viewportH_ / 2.0f};
+    }
+    SDL_FPoint screenToWorld(float x, float y) const {
+        return {(x - viewportW_ / 2.0f) / zoom_ + centerX_, (y - viewportH_ / 2.0f) / zoom_ + centerY_};
+    }
+    // Part of the world that is visible in the viewport
+    SDL_FRect getViewRect() const {
+        float w = viewportW_ / zoom_;
+        float h = viewportH_ / zoom_;
+        return {centerX_ - w / 2.0f, centerY_ - h / 2.0f, w, h};
+    }
+    bool isVisible(const SDL_FRect& worldBounds) const {
+        return rectsOverlap(getViewRect(), worldBounds);
+    }
+
+private:
+    float centerX_, centerY_;
+    float zoom_;
+    int viewportW_, viewportH_;
+};
+
+#endif // CAMERA_H
@@ -0,0 +1,194 @@
+#include "creaturebvh.h"
+#include <algorithm>
+#include <limits>
+
+static const CreatureBVH::Box EMPTY_BOX = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+                                           std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+
+static CreatureBVH::Box unionBox(const CreatureBVH::Box& a, const CreatureBVH::Box& b) {
+    return {std::min(a.minX, b.minX), std::min(a.minY, b.minY), std::max(a.maxX, b.maxX), std::max(a.maxY, b.maxY)};
+}
+
+static bool boxContains(const CreatureBVH::Box& box, float x, float y) {
+    return x >= box.minX && x <= box.maxX && y >= box.minY && y <= box.maxY;
+}
+
+static float boxDistanceSq(const CreatureBVH::Box& box, float x, float y) {
+    if (box.minX > box.maxX) return std::numeric_limits<float>::max();
+    float dx = std::max(std::max(box.minX - x, x - box.maxX), 0.0f);
+    float dy = std::max(std::max(box.minY - y, y - box.maxY), 0.0f);
+    return dx * dx + dy * dy;
+}
+
+void CreatureBVH::clear() {
+    parts_.clear();
+    nodes_.clear();
+    partIndex_.clear();
+}
+
+void CreatureBVH::build(Entity* root) {
+    clear();
+    if (!root) return;
+    addParts(root);
+
+    int count = (int)parts_.size();
+    scratch_.resize(count);
+    centers_.resize(count);
+    for (int i = 0; i < count; ++i) {
+        scratch_[i] = i;
+        centers_[i] = {parts_[i].entity->Xpos, parts_[i].entity->Ypos};
+    }
+    nodes_.reserve(2 * count - 1);
+    buildNode(0, count, -1);
+    dirty_.assign(nodes_.size(), 0);
+    for (int i = (int)nodes_.size() - 1; i >= 0; --i) {
+        if (nodes_[i].left < 0) {
+            updateLeaf(i);
+        } else {
+            mergeChildren(i);
+        }
+    }
+}
+
+int CreatureBVH::addParts(Entity* entity) {
+    int index = (int)parts_.size();
+    parts_.push_back({entity, 0, -1});
+    partIndex_[entity] = index;
+    for (auto& app : entity->appendages) {
+        addParts(app.get());
+    }
+    parts_[index].subtreeEnd = (Sint32)parts_.size();
+    return index;
+}
+
+int CreatureBVH::buildNode(int first, int end, int parent) {
+    int index = (int)nodes_.size();
+    nodes_.push_back({EMPTY_BOX, EMPTY_BOX, parent, -1, -1, scratch_[first]});
+    if (end - first == 1) {
+        parts_[scratch_[first]].leaf = index;
+        return index;
+    }
+
+    float minX = std::numeric_limits<float>::max(), maxX = std::numeric_limits<float>::lowest();
+    float minY = minX, maxY = maxX;
+    for (int i = first; i < end; ++i) {
+        const SDL_FPoint& c = centers_[scratch_[i]];
+        minX = std::min(minX, c.x);
+        maxX = std::max(maxX, c.x);
+        minY = std::min(minY, c.y);
+        maxY = std::max(maxY, c.y);
+    }
+    bool splitX = maxX - minX >= maxY - minY;
+    int mid = (first + end) / 2;
+    // Ties by part index, so the same tree always gives the same hierarchy
+    std::nth_element(scratch_.begin() + first, scratch_.begin() + mid, scratch_.begin() + end, [&](int a, int b) {
+        float ca = splitX ? centers_[a].x : centers_[a].y;
+        float cb = splitX ? centers_[b].x : centers_[b].y;
+        return ca < cb || (ca == cb && a < b);
+    });
+    int left = buildNode(first, mid, index);
+    int right = buildNode(mid, end, index);
+    nodes_[index].left = left;
+    nodes_[index].right = right;
+    return index;
+}
+
+void CreatureBVH::updateLeaf(int leaf) {
+    TreeNode& node = nodes_[leaf];
+    Entity* entity = parts_[node.part].entity;
+    SDL_FRect b = getShapeBounds(entity);
+    // The triangle test accepts points slightly outside the edges
+    float margin = 1.0f + 0.05f * b.w;
+    node.shapeBox = {b.x - margin, b.y - margin, b.x + b.w + margin, b.y + b.h + margin};
+    node.nodeBox = EMPTY_BOX;
+    for (int i = 0; i < entity->nodeCount; ++i) {
+        const Node& n = entity->nodes[i];
+        node.nodeBox = unionBox(node.nodeBox, {n.x, n.y, n.x, n.y});
+    }
+}
+
+void CreatureBVH::mergeChildren(int index) {
+    TreeNode& node = nodes_[index];
+    const TreeNode& left = nodes_[node.left];
+    const TreeNode& right = nodes_[node.right];
+    node.shapeBox = unionBox(left.shapeBox, right.shapeBox);
+    node.nodeBox = unionBox(left.nodeBox, right.nodeBox);
+    node.part = std::min(left.part, right.part);
+}
+
+void CreatureBVH::refit(const Entity* subtree) {
+    auto found = partIndex_.find(subtree);
+    if (found == partIndex_.end()) return;
+    stack_.clear();
+    for (int i = found->second; i < parts_[found->second].subtreeEnd; ++i) {
+        int leaf = parts_[i].leaf;
+        updateLeaf(leaf);
+        for (int parent = nodes_[leaf].parent; parent >= 0 && !dirty_[parent]; parent = nodes_[parent].parent) {
+            dirty_[parent] = 1;
+            stack_.push_back(parent);
+        }
+    }
+    // Children come after their parent, so deepest first
+    std::sort(stack_.begin(), stack_.end(), std::greater<int>());
+    for (int index : stack_) {
+        mergeChildren(index);
+        dirty_[index] = 0;
+    }
+}
+
+Entity* CreatureBVH::pickAppendage(float x, float y) const {
+    if (nodes_.empty()) return nullptr;
+    int best = std::numeric_limits<int>::max();
+    stack_.clear();
+    stack_.push_back(0);
+    while (!stack_.empty()) {
+        const TreeNode& node = nodes_[stack_.back()];
+        stack_.pop_back();
+        // Nothing below comes before the best hit in preorder
+        if (node.part >= best || !boxContains(node.shapeBox, x, y)) continue;
+        if (node.left < 0) {
+            Entity* entity = parts_[node.part].entity;
+            if (!entity->isCore && pointInEntityShape(x, y, entity)) {
+                best = node.part;
+            }
+            continue;
+        }
+        // The side that starts earlier in preorder is searched first
+        bool leftFirst = nodes_[node.left].part < nodes_[node.right].part;
+        stack_.push_back(leftFirst ? node.right : node.left);
+        stack_.push_back(leftFirst ? node.left : node.right);
+    }
+    return best == std::numeric_limits<int>::max() ? nullptr : parts_[best].entity;
+}
+
+bool CreatureBVH::findNearestNode(float x, float y, float radius, NodeHit& hit) const {
+    if (nodes_.empty()) return false;
+    float bestDistSq = radius * radius;
+    int bestPart = -1;
+    stack_.clear();
+    stack_.push_back(0);
+    while (!stack_.empty()) {
+        const TreeNode& node = nodes_[stack_.back()];
+        stack_.pop_back();
+        if (boxDistanceSq(node.nodeBox, x, y) > bestDistSq) continue;
+        if (node.left >= 0) {
+            stack_.push_back(node.right);
+            stack_.push_back(node.left);
+            continue;
+        }
+        Entity* entity = parts_[node.part].entity;
+        for (int i = 0; i < entity->nodeCount; ++i) {
+            float dx = x - entity->nodes[i].x;
+            float dy = y - entity->nodes[i].y;
+            float distSq = dx * dx + dy * dy;
+            bool better = bestPart < 0 ? distSq <= bestDistSq
+                                       : distSq < bestDistSq || (distSq == bestDistSq && node.part < bestPart);
+            if (better) {
+                bestDistSq = distSq;
+                bestPart = node.part;
+                hit = {entity, i, distSq};
+            }
+        }
+    }
+    return bestPart >= 0;
+}
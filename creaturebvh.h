@@ -0,0 +1,67 @@
+#ifndef CREATURE_BVH_H
+#define CREATURE_BVH_H
+
+#include <SDL3/SDL.h>
+#include <vector>
+#include <unordered_map>
+#include "entity.h"
+
+// Bounding volume hierarchy over the parts of an Entity tree, for the editor's
+// picking and node snapping. Each leaf is one part with two boxes: its shape bounds
+// and the box around its nodes. build() splits the parts at the median of the
+// longest axis. Parts that only moved need refit(), which recomputes their leaves
+// and the boxes above them; adding or removing parts or nodes needs build() again.
+class CreatureBVH {
+public:
+    struct Box {
+        float minX, minY, maxX, maxY; // empty when minX > maxX
+    };
+    struct NodeHit {
+        Entity* entity;
+        int index;   // into entity->nodes
+        float distSq;
+    };
+
+    void build(Entity* root);
+    void clear();
+    bool isBuilt() const { return !parts_.empty(); }
+    // After the parts of subtree (a part of this tree) moved
+    void refit(const Entity* subtree);
+
+    // Same answer as a preorder walk: the first appendage (not the core) whose
+    // shape contains the point, null if none
+    Entity* pickAppendage(float x, float y) const;
+    // Closest node within radius, ties go to the part that comes first in preorder
+    bool findNearestNode(float x, float y, float radius, NodeHit& hit) const;
+
+    int getPartCount() const { return (int)parts_.size(); }
+
+private:
+    struct Part {
+        Entity* entity;
+        Sint32 subtreeEnd; // parts [index, subtreeEnd) are this part and its subtree
+        Sint32 leaf;
+    };
+    struct TreeNode {
+        Box shapeBox;
+        Box nodeBox;
+        Sint32 parent;
+        Sint32 left, right; // children, -1 for a leaf
+        Sint32 part;        // leaf: its part, inner node: the first part in preorder below it
+    };
+
+    std::vector<Part> parts_;         // preorder
+    std::vector<TreeNode> nodes_;     // children after their parent, the root is nodes_[0]
+    std::unordered_map<const Entity*, int> partIndex_;
+    std::vector<int> scratch_;        // part indices while building
+    std::vector<SDL_FPoint> centers_; // part centers while building
+    mutable std::vector<int> stack_;
+    std::vector<Uint8> dirty_;        // inner nodes queued by refit()
+
+    int addParts(Entity* entity);
+    int buildNode(int first, int end, int parent);
+    void updateLeaf(int leaf);
+    void mergeChildren(int node);
+};
+
+#endif // CREATURE_BVH_H
@@ -0,0 +1,197 @@
+#include "creaturefile.h"
+#include <cstdio>
+
+bool CreatureLibrary::open(const std::string& path) {
+    close();
+    if (!file_.open(path)) return false;
+    const Uint8* data = file_.getData();
+    size_t size = file_.getSize();
+    const CreatureFileHeader* header = reinterpret_cast<const CreatureFileHeader*>(data);
+    if (size < sizeof(CreatureFileHeader) || header->magic != MAGIC || header->version != VERSION) {
+        printf("CreatureLibrary: %s is not a version %u creature file\n", path.c_str(), VERSION);
+        file_.close();
+        return false;
+    }
+    Uint64 creaturesOffset = sizeof(CreatureFileHeader);
+    Uint64 partsOffset = creaturesOffset + (Uint64)header->creatureCount * sizeof(CreatureRecord);
+    Uint64 nodesOffset = partsOffset + (Uint64)header->partCount * sizeof(CreaturePart);
+    Uint64 end = nodesOffset + (Uint64)header->nodeCount * sizeof(NodeRel);
+    if (end > size) {
+        printf("CreatureLibrary: %s is truncated\n", path.c_str());
+        file_.close();
+        return false;
+    }
+    header_ = header;
+    creatures_ = reinterpret_cast<const CreatureRecord*>(data + creaturesOffset);
+    parts_ = reinterpret_cast<const CreaturePart*>(data + partsOffset);
+    nodes_ = reinterpret_cast<const NodeRel*>(data + nodesOffset);
+    return true;
+}
+
+void CreatureLibrary::close() {
+    file_.close();
+    header_ = nullptr;
+    creatures_ = nullptr;
+    parts_ = nullptr;
+    nodes_ = nullptr;
+}
+
+bool CreatureLibrary::instantiate(int index, Entity* entity) const {
+    if (!header_ || index < 0 || index >= getCreatureCount()) return false;
+    const CreatureRecord& creature = creatures_[index];
+    bool valid = creature.partCount > 0 && creature.firstPart <= header_->partCount &&
+                 creature.partCount <= header_->partCount - creature.firstPart;
+    const CreaturePart* parts = valid ? getParts(creature) : nullptr;
+    for (Uint32 i = 0; valid && i < creature.partCount; ++i) {
+        const CreaturePart& part = parts[i];
+        valid = part.shape < SHAPE_COUNT && part.nodeCount <= MAX_NODES && part.firstNode <= header_->nodeCount &&
+                part.nodeCount <= header_->nodeCount - part.firstNode &&
+                (i == 0 ? part.parent == -1
+                        : part.parent >= 0 && (Uint32)part.parent < i && part.coreNodeIndex >= 0 &&
+                              part.coreNodeIndex < parts[part.parent].nodeCount);
+    }
+    if (!valid) {
+        printf("CreatureLibrary: creature %d is damaged\n", index);
+        return false;
+    }
+
+    destroyEntity(entity);
+    std::vector<Entity*> built(creature.partCount);
+    for (Uint32 i = 0; i < creature.partCount; ++i) {
+        const CreaturePart& part = parts[i];
+        Entity* target = entity;
+        if (i > 0) {
+            Entity* parent = built[part.parent];
+            parent->appendages.push_back(std::make_unique<Entity>(part.coreNodeIndex));
+            target = parent->appendages.back().get();
+        }
+        built[i] = target;
+        target->shapetype = (Shape)part.shape;
+        target->Xpos = part.x;
+        target->Ypos = part.y;
+        target->Xvel = 0.0f;
+        target->Yvel = 0.0f;
+        target->width = part.width;
+        target->height = part.height;
+        target->size = part.size;
+        target->onGround = false;
+        target->color = part.color;
+        target->texture = nullptr;
+        target->sharedTexture = false;
+        target->spriteDirty = true;
+        target->isCore = (part.flags & PART_CORE) != 0;
+        target->isHandOrFoot = (part.flags & PART_HAND_OR_FOOT) != 0;
+        target->isLeg = (part.flags & PART_LEG) != 0;
+        target->grabbing = false;
+        target->grabbedObject = nullptr;
+        target->coreNodeIndex = part.coreNodeIndex;
+        target->offsetX = part.offsetX;
+        target->offsetY = part.offsetY;
+        target->rotation = part.rotation;
+        target->nodeCount = part.nodeCount;
+        resetNodeIds(target);
+        const NodeRel* nodes = getNodes(part);
+        for (int n = 0; n < part.nodeCount; ++n) {
+            target->nodesRel[n] = nodes[n];
+        }
+        updateNodePositions(target);
+    }
+    return true;
+}
+
+bool CreatureLibrary::exportText(const std::string& path) const {
+    if (!header_) return false;
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) {
+        printf("CreatureLibrary: cannot create %s\n", path.c_str());
+        return false;
+    }
+    fprintf(file, "creatures version=%u count=%u parts=%u nodes=%u\n", header_->version,
+            header_->creatureCount, header_->partCount, header_->nodeCount);
+    for (int c = 0; c < getCreatureCount(); ++c) {
+        const CreatureRecord& creature = creatures_[c];
+        fprintf(file, "creature %d parts=%u\n", c, creature.partCount);
+        if (creature.firstPart > header_->partCount || creature.partCount > header_->partCount - creature.firstPart) {
+            fprintf(file, "  damaged\n");
+            continue;
+        }
+        const CreaturePart* parts = getParts(creature);
+        for (Uint32 i = 0; i < creature.partCount; ++i) {
+            const CreaturePart& part = parts[i];
+            fprintf(file, "  part %u parent=%d shape=%u flags=%u node=%d size=%d,%d,%d color=%u,%u,%u,%u "
+                          "pos=%.9g,%.9g offset=%.9g,%.9g rotation=%.9g nodes=%u\n",
+                    i, part.parent, part.shape, part.flags, part.coreNodeIndex, part.width, part.height, part.size,
+                    part.color.r, part.color.g, part.color.b, part.color.a, part.x, part.y,
+                    part.offsetX, part.offsetY, part.rotation, part.nodeCount);
+            if (part.firstNode > header_->nodeCount || part.nodeCount > header_->nodeCount - part.firstNode) continue;
+            const NodeRel* nodes = getNodes(part);
+            for (int n = 0; n < part.nodeCount; ++n) {
+                fprintf(file, "    node %d %.9g,%.9g\n", n, nodes[n].x_rel, nodes[n].y_rel);
+            }
+        }
+    }
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+void CreatureFileWriter::clear() {
+    creatures_.clear();
+    parts_.clear();
+    nodes_.clear();
+}
+
+void CreatureFileWriter::add(const Entity* root) {
+    Uint32 firstPart = (Uint32)parts_.size();
+    addPart(root, -1, -1, firstPart);
+    creatures_.push_back({firstPart, (Uint32)parts_.size() - firstPart});
+}
+
+// Node IDs only live in memory, the file refers to nodes by index
+void CreatureFileWriter::addPart(const Entity* entity, Sint32 parent, Sint32 node, Uint32 firstPart) {
+    CreaturePart part = {};
+    part.shape = (Uint8)entity->shapetype;
+    part.flags = (entity->isCore ? CreatureLibrary::PART_CORE : 0) |
+                 (entity->isHandOrFoot ? CreatureLibrary::PART_HAND_OR_FOOT : 0) |
+                 (entity->isLeg ? CreatureLibrary::PART_LEG : 0);
+    part.nodeCount = (Uint8)entity->nodeCount;
+    part.parent = parent;
+    part.coreNodeIndex = node;
+    part.width = entity->width;
+    part.height = entity->height;
+    part.size = entity->size;
+    part.color = entity->color;
+    part.x = entity->Xpos;
+    part.y = entity->Ypos;
+    part.offsetX = entity->offsetX;
+    part.offsetY = entity->offsetY;
+    part.rotation = entity->rotation;
+    part.firstNode = (Uint32)nodes_.size();
+    nodes_.insert(nodes_.end(), entity->nodesRel, entity->nodesRel + entity->nodeCount);
+    Sint32 index = (Sint32)(parts_.size() - firstPart);
+    parts_.push_back(part);
+    for (const auto& app : entity->appendages) {
+        // One that lost its node is never positioned, and instantiate would reject it
+        int appNode = findNodeIndex(entity, app->coreNodeIndex);
+        if (appNode < 0) continue;
+        addPart(app.get(), index, appNode, firstPart);
+    }
+}
+
+bool CreatureFileWriter::write(const std::string& path) const {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        printf("CreatureFileWriter: cannot create %s\n", path.c_str());
+        return false;
+    }
+    CreatureFileHeader header = {CreatureLibrary::MAGIC, CreatureLibrary::VERSION, (Uint32)creatures_.size(),
+                                 (Uint32)parts_.size(), (Uint32)nodes_.size(), 0};
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(creatures_.data(), sizeof(CreatureRecord), creatures_.size(), file);
+    fwrite(parts_.data(), sizeof(CreaturePart), parts_.size(), file);
+    fwrite(nodes_.data(), sizeof(NodeRel), nodes_.size(), file);
+    bool ok = !ferror(file);
+    if (fclose(file) != 0) ok = false;
+    if (!ok) printf("CreatureFileWriter: writing %s failed\n", path.c_str());
+    return ok;
+}
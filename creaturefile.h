@@ -0,0 +1,99 @@
+#ifndef CREATURE_FILE_H
+#define CREATURE_FILE_H
+
+#include <SDL3/SDL.h>
+#include <string>
+#include <vector>
+#include "entity.h"
+#include "mappedfile.h"
+
+// Binary file of creature trees (one design, a scene, or a library of designs).
+// Fixed layout, little endian, every field 4-byte aligned, so a mapped file is
+// used in place without parsing:
+//   CreatureFileHeader
+//   CreatureRecord[creatureCount]  parts [firstPart, firstPart + partCount) of each creature
+//   CreaturePart[partCount]        preorder, parent is an index into the creature's parts
+//   NodeRel[nodeCount]             nodesRel of all parts
+// Absolute node positions, textures and velocities are not stored, they are derived
+// or reset when a creature is instantiated.
+struct CreatureFileHeader {
+    Uint32 magic;
+    Uint32 version;
+    Uint32 creatureCount;
+    Uint32 partCount;
+    Uint32 nodeCount;
+    Uint32 reserved;
+};
+
+struct CreatureRecord {
+    Uint32 firstPart;
+    Uint32 partCount;
+};
+
+struct CreaturePart {
+    Uint8 shape;         // Shape
+    Uint8 flags;         // PART_CORE | PART_HAND_OR_FOOT | PART_LEG
+    Uint8 nodeCount;
+    Uint8 reserved;
+    Sint32 parent;       // -1 for the root
+    Sint32 coreNodeIndex;
+    Sint32 width, height, size;
+    SDL_Color color;
+    float x, y;
+    float offsetX, offsetY;
+    float rotation;
+    Uint32 firstNode;
+};
+
+static_assert(sizeof(CreatureFileHeader) == 24, "creature file layout changed");
+static_assert(sizeof(CreatureRecord) == 8, "creature file layout changed");
+static_assert(sizeof(CreaturePart) == 52, "creature file layout changed");
+static_assert(sizeof(NodeRel) == 8, "creature file layout changed");
+
+// Read side: maps the file, open() only checks the header and the section sizes
+class CreatureLibrary {
+public:
+    static constexpr Uint32 MAGIC = 0x434C4453; // "SDLC"
+    static constexpr Uint32 VERSION = 1;
+    enum : Uint8 { PART_CORE = 1, PART_HAND_OR_FOOT = 2, PART_LEG = 4 };
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return header_ != nullptr; }
+
+    int getCreatureCount() const { return header_ ? (int)header_->creatureCount : 0; }
+    const CreatureRecord& getCreature(int index) const { return creatures_[index]; }
+    const CreaturePart* getParts(const CreatureRecord& creature) const { return parts_ + creature.firstPart; }
+    const NodeRel* getNodes(const CreaturePart& part) const { return nodes_ + part.firstNode; }
+
+    // Replaces entity (and its appendages) with an editable copy of the creature.
+    // Indices are checked here, so a damaged record fails instead of reading out of bounds.
+    bool instantiate(int index, Entity* entity) const;
+    // One line per part and node, floats with enough digits to read them back exactly
+    bool exportText(const std::string& path) const;
+
+private:
+    MappedFile file_;
+    const CreatureFileHeader* header_ = nullptr;
+    const CreatureRecord* creatures_ = nullptr;
+    const CreaturePart* parts_ = nullptr;
+    const NodeRel* nodes_ = nullptr;
+};
+
+// Write side: flattens entity trees into the file sections
+class CreatureFileWriter {
+public:
+    void clear();
+    void add(const Entity* root);
+    int getCreatureCount() const { return (int)creatures_.size(); }
+    bool write(const std::string& path) const;
+
+private:
+    std::vector<CreatureRecord> creatures_;
+    std::vector<CreaturePart> parts_;
+    std::vector<NodeRel> nodes_;
+
+    void addPart(const Entity* entity, Sint32 parent, Sint32 node, Uint32 firstPart);
+};
+
+#endif // CREATURE_FILE_H
@@ -0,0 +1,217 @@
+#include "drawlist.h"
+
+// Items with more vertices than this are always drawn in place, smaller ones are
+// copied together into one batch when they are not adjacent in their RenderData
+static constexpr int BATCH_COPY_LIMIT = 4096;
+
+void DrawList::clear() {
+    for (int i = 0; i < LAYER_COUNT; ++i) {
+        layers_[i].clear();
+    }
+    items_.clear();
+    textures_.clear();
+    blendModes_.clear();
+    depth_ = 0;
+    drawCalls_ = 0;
+    sorted_ = false;
+}
+
+Uint16 DrawList::textureId(SDL_Texture* texture) {
+    if (!texture) return 0;
+    for (size_t i = 0; i < textures_.size(); ++i) {
+        if (textures_[i] == texture) return (Uint16)(i + 1);
+    }
+    textures_.push_back(texture);
+    return (Uint16)textures_.size();
+}
+
+Uint8 DrawList::blendId(SDL_BlendMode blend) {
+    if (blend == SDL_BLENDMODE_NONE) return 0;
+    for (size_t i = 0; i < blendModes_.size(); ++i) {
+        if (blendModes_[i] == blend) return (Uint8)(i + 1);
+    }
+    blendModes_.push_back(blend);
+    return (Uint8)blendModes_.size();
+}
+
+void DrawList::addRange(DrawLayer layer, const RenderData* data, const RenderRange& range, Uint16 depth,
+                        SDL_Texture* texture, SDL_BlendMode blend) {
+    if (range.indexCount <= 0) return;
+    Uint64 key = makeDrawKey(layer, depth, blendId(blend), textureId(texture), (Uint32)items_.size());
+    items_.push_back({key, data, range, texture, blend});
+    sorted_ = false;
+}
+
+void DrawList::addStatic(DrawLayer layer, const RenderData* data, SDL_Texture* texture, SDL_BlendMode blend) {
+    for (int chunk = 0; chunk < data->chunkCount(); ++chunk) {
+        int firstVertex = data->chunks[chunk].firstVertex;
+        RenderRange range = {chunk, firstVertex, firstVertex + data->chunkVertexCount(chunk),
+                             data->chunks[chunk].firstIndex, data->chunkIndexCount(chunk)};
+        addRange(layer, data, range, depth_, texture, blend);
+    }
+}
+
+// Commands that emit a lot of geometry (entity trees) can cross chunks, one item per chunk
+void DrawList::addCommand(DrawLayer layer, int vertexStart, int indexStart) {
+    const RenderData& data = layers_[(int)layer];
+    int chunk = data.chunkCount() - 1;
+    while (chunk > 0 && data.chunks[chunk].firstVertex > vertexStart) --chunk;
+    for (; chunk >= 0 && chunk < data.chunkCount(); ++chunk) {
+        const RenderChunk& c = data.chunks[chunk];
+        int firstIndex = std::max(indexStart, c.firstIndex);
+        RenderRange range = {chunk, std::max(vertexStart, c.firstVertex), c.firstVertex + data.chunkVertexCount(chunk),
+                             firstIndex, c.firstIndex + data.chunkIndexCount(chunk) - firstIndex};
+        addRange(layer, &data, range, depth_);
+    }
+}
+
+void DrawList::rect(DrawLayer layer, const SDL_FRect& rect, SDL_Color color) {
+    RenderData& data = layers_[(int)layer];
+    int vertexStart = data.vertexCount(), indexStart = data.indexCount();
+    SDL_FPoint corners[4] = {
+        {rect.x, rect.y}, {rect.x + rect.w, rect.y}, {rect.x + rect.w, rect.y + rect.h}, {rect.x, rect.y + rect.h}
+    };
+    emitQuad(data, corners, toFColor(color));
+    addCommand(layer, vertexStart, indexStart);
+}
+
+// Four thin quads just inside the rect, like SDL_RenderRect
+void DrawList::rectOutline(DrawLayer layer, const SDL_FRect& r, SDL_Color color, float thickness) {
+    rect(layer, {r.x, r.y, r.w, thickness}, color);
+    rect(layer, {r.x, r.y + r.h - thickness, r.w, thickness}, color);
+    rect(layer, {r.x, r.y + thickness, thickness, r.h - 2 * thickness}, color);
+    rect(layer, {r.x + r.w - thickness, r.y + thickness, thickness, r.h - 2 * thickness}, color);
+}
+
+void DrawList::line(DrawLayer layer, float x1, float y1, float x2, float y2, SDL_Color color, float thickness) {
+    RenderData& data = layers_[(int)layer];
+    int vertexStart = data.vertexCount(), indexStart = data.indexCount();
+    emitLine(data, x1, y1, x2, y2, thickness, toFColor(color));
+    addCommand(layer, vertexStart, indexStart);
+}
+
+void DrawList::circle(DrawLayer layer, float cx, float cy, float radius, SDL_Color color, int sides) {
+    RenderData& data = layers_[(int)layer];
+    int vertexStart = data.vertexCount(), indexStart = data.indexCount();
+    emitCircle(data, cx, cy, radius, sides, toFColor(color));
+    addCommand(layer, vertexStart, indexStart);
+}
+
+void DrawList::triangle(DrawLayer layer, SDL_FPoint p1, SDL_FPoint p2, SDL_FPoint p3, SDL_Color color) {
+    RenderData& data = layers_[(int)layer];
+    int vertexStart = data.vertexCount(), indexStart = data.indexCount();
+    emitTriangle(data, p1, p2, p3, toFColor(color));
+    addCommand(layer, vertexStart, indexStart);
+}
+
+void DrawList::polygon(DrawLayer layer, const SDL_FPoint* points, int count, SDL_Color color) {
+    RenderData& data = layers_[(int)layer];
+    int vertexStart = data.vertexCount(), indexStart = data.indexCount();
+    emitPolygon(data, points, count, toFColor(color));
+    addCommand(layer, vertexStart, indexStart);
+}
+
+void DrawList::entity(DrawLayer layer, Entity* entity, bool includeNodes) {
+    RenderData& data = layers_[(int)layer];
+    int vertexStart = data.vertexCount(), indexStart = data.indexCount();
+    Renderer::collectShapeGeometry(entity, data);
+    if (includeNodes) {
+        Renderer::collectNodeGeometry(entity, data);
+    }
+    addCommand(layer, vertexStart, indexStart);
+}
+
+// LSD radix sort of the item indices in [first, end) by key, 8 bits per pass.
+// Passes where all keys share the digit (most of them: few layers, depths and
+// textures per frame) are skipped.
+void DrawList::sortItems(DrawLayer first, DrawLayer end) {
+    if (sorted_ && first == sortedFirst_ && end == sortedEnd_) return;
+    sorted_ = true;
+    sortedFirst_ = first;
+    sortedEnd_ = end;
+    order_.clear();
+    for (Uint32 i = 0; i < (Uint32)items_.size(); ++i) {
+        DrawLayer layer = (DrawLayer)(items_[i].key >> 60);
+        if (layer >= first && layer < end) order_.push_back(i);
+    }
+    if (order_.empty()) return;
+    sortScratch_.resize(order_.size());
+    for (int shift = 0; shift < 64; shift += 8) {
+        Uint32 counts[256] = {};
+        for (Uint32 index : order_) {
+            ++counts[(items_[index].key >> shift) & 0xFF];
+        }
+        if (counts[(items_[order_[0]].key >> shift) & 0xFF] == order_.size()) continue;
+        Uint32 offset = 0;
+        for (Uint32& count : counts) {
+            Uint32 n = count;
+            count = offset;
+            offset += n;
+        }
+        for (Uint32 index : order_) {
+            sortScratch_[counts[(items_[index].key >> shift) & 0xFF]++] = index;
+        }
+        order_.swap(sortScratch_);
+    }
+}
+
+void DrawList::flush(Renderer& renderer, const ViewTransform& worldView) {
+    flushLayers(renderer, worldView, DrawLayer::SPRITES, DrawLayer::COUNT);
+}
+
+void DrawList::flushLayers(Renderer& renderer, const ViewTransform& worldView, DrawLayer first, DrawLayer end) {
+    sortItems(first, end);
+    if (order_.empty()) return;
+
+    // Pending run: a range drawn in place, or copies of several ranges in batch_
+    const DrawItem* run = nullptr;
+    RenderRange direct = {};
+    bool batched = false;
+    auto submitRun = [&]() {
+        if (!run) return;
+        const ViewTransform* view = isWorldLayer((DrawLayer)(run->key >> 60)) ? &worldView : nullptr;
+        if (!run->texture) renderer.setDrawBlendMode(run->blend);
+        if (batched) {
+            renderer.renderBatchedGeometry(batch_, run->texture, view);
+            drawCalls_ += batch_.chunkCount();
+        } else {
+            renderer.renderRange(*run->data, direct, run->texture, view);
+            ++drawCalls_;
+        }
+        run = nullptr;
+    };
+    auto sameState = [](const DrawItem& a, const DrawItem& b) {
+        return isWorldLayer((DrawLayer)(a.key >> 60)) == isWorldLayer((DrawLayer)(b.key >> 60)) &&
+               a.texture == b.texture && a.blend == b.blend;
+    };
+
+    for (Uint32 index : order_) {
+        const DrawItem& item = items_[index];
+        const RenderRange& range = item.range;
+        bool small = range.vertexEnd - range.firstVertex <= BATCH_COPY_LIMIT;
+        if (run && !sameState(*run, item)) submitRun();
+        if (!run) {
+            run = &item;
+            direct = range;
+            batched = false;
+        } else if (!batched && item.data == run->data && range.chunk == direct.chunk &&
+                   range.firstIndex == direct.firstIndex + direct.indexCount) {
+            direct.firstVertex = std::min(direct.firstVertex, range.firstVertex);
+            direct.vertexEnd = std::max(direct.vertexEnd, range.vertexEnd);
+            direct.indexCount += range.indexCount;
+        } else if (small && (batched || direct.vertexEnd - direct.firstVertex <= BATCH_COPY_LIMIT)) {
+            if (!batched) {
+                batch_.clear();
+                batch_.appendRange(*run->data, direct);
+                batched = true;
+            }
+            batch_.appendRange(*item.data, range);
+        } else {
+            submitRun();
+            run = &item;
+            direct = range;
+            batched = false;
+        }
+    }
+    submitRun();
+}
@@ -0,0 +1,95 @@
+#ifndef DRAW_LIST_H
+#define DRAW_LIST_H
+
+#include <SDL3/SDL.h>
+#include <vector>
+#include "entity.h"
+#include "Renderer.h"
+
+// Layers are drawn in this order. Layers up to DEBUG are in world space and go
+// through the camera's view transform, the UI layers are in screen pixels.
+enum class DrawLayer {
+    SPRITES,    // sprite cache atlas quads
+    WORLD,      // creatures, objects
+    DEBUG,      // ground line, debug lines
+    UI,         // inventory buttons
+    UI_OVERLAY, // button highlights
+    COUNT
+};
+
+inline bool isWorldLayer(DrawLayer layer) {
+    return layer <= DrawLayer::DEBUG;
+}
+
+// Sort key of a draw item, most significant bits first:
+//   layer (4) | depth (16) | blend (4) | texture (16) | sequence (24)
+// Within a layer and depth items may be regrouped by blend mode and texture, the
+// sequence (submission order) keeps the order stable otherwise.
+inline Uint64 makeDrawKey(DrawLayer layer, Uint16 depth, Uint8 blend, Uint16 texture, Uint32 sequence) {
+    return ((Uint64)layer << 60) | ((Uint64)depth << 44) | ((Uint64)(blend & 0xF) << 40) |
+           ((Uint64)texture << 24) | (sequence & 0xFFFFFF);
+}
+
+// Collects a frame's draw items with explicit sort keys. flush() radix sorts the
+// keys and merges consecutive items with the same space, texture and blend mode into
+// one backend call per 64k vertex chunk. Items that follow each other in the same
+// RenderData are submitted in place, other runs are copied into a batch first.
+class DrawList {
+public:
+    void clear();
+
+    // Depth of the commands added after this call, lower depths are drawn first
+    void setDepth(Uint16 depth) { depth_ = depth; }
+
+    void rect(DrawLayer layer, const SDL_FRect& rect, SDL_Color color);
+    void rectOutline(DrawLayer layer, const SDL_FRect& rect, SDL_Color color, float thickness = 1.0f);
+    void line(DrawLayer layer, float x1, float y1, float x2, float y2, SDL_Color color, float thickness = 1.0f);
+    void circle(DrawLayer layer, float cx, float cy, float radius, SDL_Color color, int sides = 32);
+    void triangle(DrawLayer layer, SDL_FPoint p1, SDL_FPoint p2, SDL_FPoint p3, SDL_Color color);
+    void polygon(DrawLayer layer, const SDL_FPoint* points, int count, SDL_Color color);
+    void entity(DrawLayer layer, Entity* entity, bool includeNodes = true);
+
+    // Geometry owned by the caller (static UI, render snapshots), must stay alive until
+    // flush. addStatic adds one item per chunk at the current depth, addRange one item.
+    void addStatic(DrawLayer layer, const RenderData* data, SDL_Texture* texture = nullptr,
+                   SDL_BlendMode blend = SDL_BLENDMODE_NONE);
+    void addRange(DrawLayer layer, const RenderData* data, const RenderRange& range, Uint16 depth,
+                  SDL_Texture* texture = nullptr, SDL_BlendMode blend = SDL_BLENDMODE_NONE);
+
+    void flush(Renderer& renderer, const ViewTransform& worldView);
+    // Only layers [first, end), for drawing world and UI to different targets. Can be
+    // called repeatedly (split views), the items are only sorted once.
+    void flushLayers(Renderer& renderer, const ViewTransform& worldView, DrawLayer first, DrawLayer end);
+    int getDrawCallCount() const { return drawCalls_; }
+    int getItemCount() const { return (int)items_.size(); }
+
+private:
+    struct DrawItem {
+        Uint64 key;
+        const RenderData* data;
+        RenderRange range;
+        SDL_Texture* texture;
+        SDL_BlendMode blend;
+    };
+
+    static constexpr int LAYER_COUNT = (int)DrawLayer::COUNT;
+    RenderData layers_[LAYER_COUNT]; // Geometry of the draw commands
+    std::vector<DrawItem> items_;
+    std::vector<SDL_Texture*> textures_;   // Texture ids of this frame, id 0 is no texture
+    std::vector<SDL_BlendMode> blendModes_; // Same for blend modes, id 0 is NONE
+    std::vector<Uint32> order_, sortScratch_;
+    bool sorted_ = false;            // order_ is up to date for sortedFirst_/sortedEnd_
+    DrawLayer sortedFirst_ = DrawLayer::COUNT, sortedEnd_ = DrawLayer::COUNT;
+    RenderData batch_;
+    Uint16 depth_ = 0;
+    int drawCalls_ = 0;
+
+    Uint16 textureId(SDL_Texture* texture);
+    Uint8 blendId(SDL_BlendMode blend);
+    // Records the geometry emitted into layers_[layer] since the given counts as one item
+    void addCommand(DrawLayer layer, int vertexStart, int indexStart);
+    void sortItems(DrawLayer first, DrawLayer end);
+    void submit(Renderer& renderer, const DrawItem& item, const ViewTransform& worldView);
+};
+
+#endif // DRAW_LIST_H
@@ -1,5 +1,6 @@
 #include "entity.h"
 #include "Renderer.h"
+#include "shapetraits.h"
 #include <cmath>
 #include <algorithm>
 #include <iostream>
@@ -40,72 +41,8 @@ SDL_FPoint relativeToAbsolute(Entity* entity, NodeRel nodeRel) {
     return abs;
 }
 
-bool pointInRectangle(float px, float py, Entity* entity) {
-    float cx = entity->Xpos;
-    float cy = entity->Ypos;
-    float rot = -entity->rotation;
-    float dx = px - cx;
-    float dy = py - cy;
-    float rx = dx * cos(rot) - dy * sin(rot);
-    float ry = dx * sin(rot) + dy * cos(rot);
-    float left = -entity->width / 2.0f;
-    float right = entity->width / 2.0f;
-    float top = -entity->height / 2.0f;
-    float bottom = entity->height / 2.0f;
-    bool inside = (rx >= left && rx <= right && ry >= top && ry <= bottom);
-    printf("Checking point in rectangle: px=%.2f, py=%.2f, center=(%.2f, %.2f), w=%d, h=%d, rotation=%.2f, rx=%.2f, ry=%.2f, inside=%d\n",
-           px, py, cx, cy, entity->width, entity->height, entity->rotation, rx, ry, inside);
-    return inside;
-}
-
-bool pointInCircle(float px, float py, Entity* entity) {
-    float dx = px - entity->Xpos;
-    float dy = py - entity->Ypos;
-    float r = entity->width / 2.0f;
-    bool inside = (dx * dx + dy * dy <= r * r);
-    printf("Checking point in circle: px=%.2f, py=%.2f, center=(%.2f, %.2f), radius=%.2f, inside=%d\n",
-           px, py, entity->Xpos, entity->Ypos, r, inside);
-    return inside;
-}
-
-bool pointInTriangle(float px, float py, Entity* entity) {
-    float s = entity->width / 2.0f;
-    float cx = entity->Xpos;
-    float cy = entity->Ypos;
-    float rot = entity->rotation;
-    SDL_FPoint p1 = {0.0f, -s};
-    SDL_FPoint p2 = {-s, s};
-    SDL_FPoint p3 = {s, s};
-    SDL_FPoint rp1, rp2, rp3;
-    rp1.x = cx + (p1.x * cos(rot) - p1.y * sin(rot));
-    rp1.y = cy + (p1.x * sin(rot) + p1.y * cos(rot));
-    rp2.x = cx + (p2.x * cos(rot) - p2.y * sin(rot));
-    rp2.y = cy + (p2.x * sin(rot) + p2.y * cos(rot));
-    rp3.x = cx + (p3.x * cos(rot) - p3.y * sin(rot));
-    rp3.y = cy + (p3.x * sin(rot) + p3.y * cos(rot));
-    float denom = (rp2.y - rp3.y) * (rp1.x - rp3.x) + (rp3.x - rp2.x) * (rp1.y - rp3.y);
-    if (fabs(denom) < 0.0001f) { // Relaxed tolerance
-        printf("Triangle point check failed: near-degenerate triangle, denom=%.6f\n", denom);
-        return false;
-    }
-    float a = ((rp2.y - rp3.y) * (px - rp3.x) + (rp3.x - rp2.x) * (py - rp3.y)) / denom;
-    float b = ((rp3.y - rp1.y) * (px - rp3.x) + (rp1.x - rp3.x) * (py - rp3.y)) / denom;
-    float c = 1.0f - a - b;
-    bool inside = (a >= -0.01f && b >= -0.01f && c >= -0.01f && (a + b + c) <= 1.01f); // Relaxed bounds
-    printf("Checking point in triangle: px=%.2f, py=%.2f, center=(%.2f, %.2f), s=%.2f, rotation=%.2f, a=%.2f, b=%.2f, c=%.2f, inside=%d\n",
-           px, py, cx, cy, s, rot, a, b, c, inside);
-    return inside;
-}
-
 bool pointInEntityShape(float px, float py, Entity* entity) {
-    bool result = false;
-    switch (entity->shapetype) {
-        case RECTANGLE: result = pointInRectangle(px, py, entity); break;
-        case CIRCLE: result = pointInCircle(px, py, entity); break;
-        case TRIANGLE: result = pointInTriangle(px, py, entity); break;
-        default: printf("Unknown shape type: %d\n", entity->shapetype); break;
-    }
-    return result;
+    return visitShape(entity->shapetype, [&](auto traits) { return decltype(traits)::contains(px, py, entity); });
 }
 
 void GenerateNodes(Entity* entity) {
@@ -114,27 +51,44 @@ void GenerateNodes(Entity* entity) {
         return;
     }
     entity->nodeCount = 0;
-    switch (entity->shapetype) {
-        case RECTANGLE:
-        case CIRCLE: {
-            entity->nodesRel[0] = {0.0f, -1.0f}; // top
-            entity->nodesRel[1] = {0.0f, 1.0f};  // bottom
-            entity->nodesRel[2] = {-1.0f, 0.0f}; // left
-            entity->nodesRel[3] = {1.0f, 0.0f};  // right
-            entity->nodeCount = 4;
-            break;
+    resetNodeIds(entity);
+    visitShape(entity->shapetype, [&](auto traits) {
+        for (const NodeRel& rel : decltype(traits)::NODES) {
+            entity->nodesRel[entity->nodeCount++] = rel;
         }
-        case TRIANGLE: {
-            entity->nodesRel[0] = {0.0f, -1.0f}; // top
-            entity->nodesRel[1] = {-1.0f, 1.0f}; // bottom left
-            entity->nodesRel[2] = {1.0f, 1.0f};  // bottom right
-            entity->nodeCount = 3;
-            break;
-        }
-    }
+    });
     updateNodePositions(entity);
 }
 
+void resetNodeIds(Entity* entity) {
+    for (int i = 0; i < MAX_NODES; ++i) {
+        entity->nodeIds[i] = (Uint8)i;
+        entity->nodeSlots[i] = (Uint8)i;
+    }
+}
+
+int findNodeIndex(const Entity* entity, int nodeId) {
+    if (nodeId < 0 || nodeId >= MAX_NODES) return -1;
+    int index = entity->nodeSlots[nodeId];
+    return index < entity->nodeCount ? index : -1;
+}
+
+void removeNodeById(Entity* entity, int nodeId) {
+    int index = findNodeIndex(entity, nodeId);
+    if (index < 0) return;
+    int last = entity->nodeCount - 1;
+    Uint8 lastId = entity->nodeIds[last];
+    entity->nodes[index] = entity->nodes[last];
+    entity->nodesRel[index] = entity->nodesRel[last];
+    entity->nodeIds[index] = lastId;
+    entity->nodeSlots[lastId] = (Uint8)index;
+    // The freed ID goes to the front of the free range, addNodeToEntity reuses it next
+    entity->nodeIds[last] = (Uint8)nodeId;
+    entity->nodeSlots[nodeId] = (Uint8)last;
+    entity->nodeCount--;
+    entity->spriteDirty = true;
+}
+
 void updateNodePositions(Entity* entity) {
     for (int i = 0; i < entity->nodeCount; ++i) {
         SDL_FPoint abs = relativeToAbsolute(entity, entity->nodesRel[i]);
@@ -144,123 +98,24 @@ void updateNodePositions(Entity* entity) {
 }
 
 SDL_FPoint clampNodeToShape(SDL_FPoint pt, Entity* entity) {
-    switch (entity->shapetype) {
-        case RECTANGLE: {
-            float hw = entity->width / 2.0f;
-            float hh = entity->height / 2.0f;
-            float cx = entity->Xpos;
-            float cy = entity->Ypos;
-            float rot = -entity->rotation;
-            float dx = pt.x - cx;
-            float dy = pt.y - cy;
-            float rx = dx * cos(rot) - dy * sin(rot);
-            float ry = dx * sin(rot) + dy * cos(rot);
-            rx = std::clamp(rx, -hw, hw);
-            ry = std::clamp(ry, -hh, hh);
-            pt.x = cx + rx * cos(-rot) - ry * sin(-rot);
-            pt.y = cy + rx * sin(-rot) + ry * cos(-rot);
-            break;
-        }
-        case CIRCLE: {
-            float r = entity->width / 2.0f;
-            float cx = entity->Xpos;
-            float cy = entity->Ypos;
-            float dx = pt.x - cx;
-            float dy = pt.y - cy;
-            float dist = sqrt(dx * dx + dy * dy);
-            if (dist > r && dist > 0.0001f) {
-                float scale = r / dist;
-                pt.x = cx + dx * scale;
-                pt.y = cy + dy * scale;
-            }
-            break;
-        }
-        case TRIANGLE: {
-            float s = entity->width / 2.0f;
-            float cx = entity->Xpos;
-            float cy = entity->Ypos;
-            float rot = -entity->rotation;
-            float dx = pt.x - cx;
-            float dy = pt.y - cy;
-            float rx = dx * cos(rot) - dy * sin(rot);
-            float ry = dx * sin(rot) + dy * cos(rot);
-            // Triangle bounds: top vertex at (0, -s), bottom left (-s, s), bottom right (s, s)
-            // Use barycentric coordinates to clamp
-            SDL_FPoint p1 = {0.0f, -s};
-            SDL_FPoint p2 = {-s, s};
-            SDL_FPoint p3 = {s, s};
-            float denom = (p2.y - p3.y) * (p1.x - p3.x) + (p3.x - p2.x) * (p1.y - p3.y);
-            if (fabs(denom) < 0.0001f) {
-                return pt; // Degenerate triangle
-            }
-            float a = ((p2.y - p3.y) * (rx - p3.x) + (p3.x - p2.x) * (ry - p3.y)) / denom;
-            float b = ((p3.y - p1.y) * (rx - p3.x) + (p1.x - p3.x) * (ry - p3.y)) / denom;
-            float c = 1.0f - a - b;
-            a = std::clamp(a, 0.0f, 1.0f);
-            b = std::clamp(b, 0.0f, 1.0f);
-            c = std::clamp(c, 0.0f, 1.0f);
-            float sum = a + b + c;
-            if (sum > 0.0001f) {
-                a /= sum;
-                b /= sum;
-                c /= sum;
-            }
-            rx = a * p1.x + b * p2.x + c * p3.x;
-            ry = a * p1.y + b * p2.y + c * p3.y;
-            pt.x = cx + rx * cos(-rot) - ry * sin(-rot);
-            pt.y = cy + rx * sin(-rot) + ry * cos(-rot);
-            break;
-        }
-    }
-    return pt;
+    return visitShape(entity->shapetype, [&](auto traits) { return decltype(traits)::clamp(pt, entity); });
 }
 
 NodeRel clampRelativeNodeToShape(NodeRel rel, Entity* entity) {
-    switch (entity->shapetype) {
-        case RECTANGLE:
-        case CIRCLE: {
-            rel.x_rel = std::clamp(rel.x_rel, -1.0f, 1.0f);
-            rel.y_rel = std::clamp(rel.y_rel, -1.0f, 1.0f);
-            if (entity->shapetype == CIRCLE) {
-                float dist = sqrt(rel.x_rel * rel.x_rel + rel.y_rel * rel.y_rel);
-                if (dist > 1.0f && dist > 0.0001f) {
-                    float scale = 1.0f / dist;
-                    rel.x_rel *= scale;
-                    rel.y_rel *= scale;
-                }
-            }
-            break;
-        }
-        case TRIANGLE: {
-            float a = -rel.y_rel;
-            float b = (rel.x_rel + rel.y_rel) / 2.0f;
-            float c = 1.0f - a - b;
-            a = std::clamp(a, 0.0f, 1.0f);
-            b = std::clamp(b, 0.0f, 1.0f);
-            c = std::clamp(c, 0.0f, 1.0f);
-            float sum = a + b + c;
-            if (sum > 0.0001f) {
-                a /= sum;
-                b /= sum;
-                c /= sum;
-            }
-            rel.x_rel = -b + c;
-            rel.y_rel = -a + b + c;
-            break;
-        }
-    }
-    return rel;
+    return visitShape(entity->shapetype, [&](auto traits) { return decltype(traits)::clampRelative(rel); });
 }
 
 void switchShape(Entity* entity, Shape newShape) {
     entity->shapetype = newShape;
+    entity->spriteDirty = true;
     GenerateNodes(entity);
 }
 
 void updateAppendagePositions(Entity* entity) {
     for (auto& app : entity->appendages) {
-        if (app->coreNodeIndex >= 0 && app->coreNodeIndex < entity->nodeCount) {
-            SDL_FPoint nodePos = {entity->nodes[app->coreNodeIndex].x, entity->nodes[app->coreNodeIndex].y};
+        int node = findNodeIndex(entity, app->coreNodeIndex);
+        if (node >= 0) {
+            SDL_FPoint nodePos = {entity->nodes[node].x, entity->nodes[node].y};
             float rot = entity->rotation;
             app->Xpos = nodePos.x + app->offsetX * cos(rot) - app->offsetY * sin(rot);
             app->Ypos = nodePos.y + app->offsetX * sin(rot) + app->offsetY * cos(rot);
@@ -282,6 +137,7 @@ bool addNodeToEntity(Entity* entity, float mouseX, float mouseY) {
     SDL_FPoint abs = relativeToAbsolute(entity, rel);
     entity->nodes[entity->nodeCount] = {abs.x, abs.y};
     entity->nodeCount++;
+    entity->spriteDirty = true;
     printf("Added node %d at x=%.2f, y=%.2f (rel: %.2f, %.2f) to entity at (%.2f, %.2f)\n",
            entity->nodeCount - 1, abs.x, abs.y, rel.x_rel, rel.y_rel, entity->Xpos, entity->Ypos);
     return true;
@@ -294,86 +150,35 @@ bool shouldRemoveAppendage(const std::unique_ptr<Entity>& entity) {
     return entity->appendages.empty();
 }
 
-void deleteAppendagesAtNode(Entity* entity, int nodeIndex)
+// Only the appendages hanging on this entity's node, their subtrees go with them
+static int deleteAppendagesAtNode(Entity* entity, int nodeId)
 {
-    if (!entity) return;
-
-    auto it = entity->appendages.begin();
-    while (it != entity->appendages.end()) {
-        if ((*it)->coreNodeIndex == nodeIndex) {
-            for(auto& app : (*it)->appendages) {
-                destroyEntity(app.get());
-            }
-            (*it)->appendages.clear();
-            destroyEntity(it->get());
-            it = entity->appendages.erase(it);
+    size_t kept = 0;
+    for (size_t i = 0; i < entity->appendages.size(); ++i) {
+        if (entity->appendages[i]->coreNodeIndex == nodeId) {
+            destroyEntity(entity->appendages[i].get());
         } else {
-            ++it;
+            entity->appendages[kept++] = std::move(entity->appendages[i]);
         }
     }
-    for (auto& app : entity->appendages) {
-        deleteAppendagesAtNode(app.get(), nodeIndex);
+    int deleted = (int)(entity->appendages.size() - kept);
+    if (deleted > 0) {
+        entity->appendages.resize(kept);
+        entity->spriteDirty = true;
     }
-
+    return deleted;
 }
 
-void removeNodeFromEntity(Entity* entity, float mouseX, float mouseY) {
-    float minDist = 100.0f; // Threshold for node proximity
-    int closestNode = -1;
-    for (int i = 0; i < entity->nodeCount; i++) {
-        float dx = mouseX - entity->nodes[i].x;
-        float dy = mouseY - entity->nodes[i].y;
-        float dist = dx * dx + dy * dy;
-        if (dist < minDist) {
-            bool nodeInUse = false;
-            for (const auto& app : entity->appendages) {
-                if (app->coreNodeIndex == i) {
-                    nodeInUse = true;
-                    break;
-                }
-            }
-            if (!nodeInUse) {
-                minDist = dist;
-                closestNode = i;
-            } else 
-            {
-                deleteAppendagesAtNode(entity, i);
-                minDist = dist;
-                closestNode = i;
-                printf("Deleted appendages at node %d before removal\n", i);
-            }
-        }
-    }
-    if (closestNode >= 0) {
-        for (int i = closestNode; i < entity->nodeCount - 1; i++) {
-            entity->nodes[i] = entity->nodes[i + 1];
-            entity->nodesRel[i] = entity->nodesRel[i + 1];
-            for (auto& app : entity->appendages) {
-                if (app->coreNodeIndex > closestNode) {
-                    app->coreNodeIndex--;
-                }
-            }
-        }
-        entity->nodeCount--;
-        printf("Removed node %d from entity at (%.2f, %.2f), new nodeCount=%d\n",
-               closestNode, entity->Xpos, entity->Ypos, entity->nodeCount);
-    }
-
-    for (auto& app : entity->appendages) {
-        removeNodeFromEntity(app.get(), mouseX, mouseY);
+void removeNodeFromEntity(Entity* entity, int nodeIndex) {
+    if (nodeIndex < 0 || nodeIndex >= entity->nodeCount) return;
+    int nodeId = entity->nodeIds[nodeIndex];
+    int deleted = deleteAppendagesAtNode(entity, nodeId);
+    if (deleted > 0) {
+        printf("Deleted %d appendage(s) at node %d before removal\n", deleted, nodeId);
     }
-}
-
-Entity* findAppendageAtPoint(Entity* entity, float px, float py) {
-    if (!entity->isCore && pointInEntityShape(px, py, entity)) {
-        printf("Found appendage at x=%.2f, y=%.2f, isHandOrFoot=%d\n", px, py, entity->isHandOrFoot);
-        return entity;
-    }
-    for (auto& app : entity->appendages) {
-        Entity* result = findAppendageAtPoint(app.get(), px, py);
-        if (result) return result;
-    }
-    return nullptr;
+    removeNodeById(entity, nodeId);
+    printf("Removed node %d from entity at (%.2f, %.2f), new nodeCount=%d\n",
+           nodeId, entity->Xpos, entity->Ypos, entity->nodeCount);
 }
 
 bool isEntityOnGround(Entity* entity, float groundY) {
@@ -385,11 +190,38 @@ bool isEntityOnGround(Entity* entity, float groundY) {
     return lowestY >= groundY;
 }
 
+// Conservative axis aligned box of the entity's own shape, valid for any rotation
+SDL_FRect getShapeBounds(Entity* entity) {
+    float r = 0.5f * std::sqrt(2.0f) * std::max(entity->width, entity->height);
+    return {entity->Xpos - r, entity->Ypos - r, 2.0f * r, 2.0f * r};
+}
+
+// Box around the entity, its node markers and all of its appendages
+SDL_FRect getEntityBounds(Entity* entity) {
+    SDL_FRect b = getShapeBounds(entity);
+    float minX = b.x, minY = b.y, maxX = b.x + b.w, maxY = b.y + b.h;
+    for (int i = 0; i < entity->nodeCount; ++i) {
+        minX = std::min(minX, entity->nodes[i].x - 3.0f);
+        minY = std::min(minY, entity->nodes[i].y - 3.0f);
+        maxX = std::max(maxX, entity->nodes[i].x + 3.0f);
+        maxY = std::max(maxY, entity->nodes[i].y + 3.0f);
+    }
+    for (auto& app : entity->appendages) {
+        SDL_FRect ab = getEntityBounds(app.get());
+        minX = std::min(minX, ab.x);
+        minY = std::min(minY, ab.y);
+        maxX = std::max(maxX, ab.x + ab.w);
+        maxY = std::max(maxY, ab.y + ab.h);
+    }
+    return {minX, minY, maxX - minX, maxY - minY};
+}
+
 void destroyEntity(Entity* entity) {
-    if (entity->texture) {
+    if (entity->texture && !entity->sharedTexture) {
         SDL_DestroyTexture(entity->texture);
-        entity->texture = nullptr;
     }
+    entity->texture = nullptr;
+    entity->sharedTexture = false;
     for (auto& app : entity->appendages) {
         destroyEntity(app.get());
     }
@@ -409,7 +241,10 @@ void initEntity(Entity* entity, Renderer* renderer, float Xpos, float Ypos, int
     entity->onGround = false;
     entity->color = color;
     entity->texture = nullptr;
+    entity->sharedTexture = false;
+    entity->spriteDirty = true;
     entity->nodeCount = 0;
+    resetNodeIds(entity);
     entity->isHandOrFoot = isHandOrFoot;
     entity->isLeg = isHandOrFoot && shape == Shape::RECTANGLE;
     entity->grabbing = false;
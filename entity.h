@@ -8,7 +8,8 @@ struct Entity;
 typedef enum {
     RECTANGLE,
     CIRCLE,
-    TRIANGLE
+    TRIANGLE,
+    SHAPE_COUNT // number of shapes, see shapetraits.h
 } Shape;
 typedef struct {
     float x;
@@ -24,15 +25,23 @@ struct Entity {
     int width, height, size;
     bool onGround;
     SDL_Color color;
-    SDL_Texture* texture;
+    SDL_Texture* texture = nullptr;
+    SDL_FRect textureRect = {0.0f, 0.0f, 0.0f, 0.0f}; // Region of texture to draw (sprite cache atlas slot)
+    bool sharedTexture = false; // True if texture is the sprite cache atlas, not owned by this entity
+    bool spriteDirty = true; // Set on structural or color edits, cleared when the sprite cache re-bakes
     Node nodes[MAX_NODES];
     NodeRel nodesRel[MAX_NODES];
     int nodeCount;
+    // Nodes are packed in [0, nodeCount), appendages refer to them by an ID that stays
+    // the same when other nodes are removed. nodeIds[i] is the ID of node i, the IDs
+    // in [nodeCount, MAX_NODES) are free, nodeSlots[id] is the index of a node.
+    Uint8 nodeIds[MAX_NODES];
+    Uint8 nodeSlots[MAX_NODES];
     bool isCore; // True for core shape (torso), false for appendages
     bool isHandOrFoot; // True for hands or feet appendages
-    bool isLeg; // New flag for legs
+    bool isLeg = false; // New flag for legs
     bool grabbing = false; // True if this entity is grabbing something
-    int coreNodeIndex; // Index of the core shape's node this appendage is attached to (-1 for core)
+    int coreNodeIndex; // ID of the parent's node this appendage is attached to (-1 for core), see nodeIds
     float offsetX, offsetY;
     float rotation;
     Entity* grabbedObject = nullptr;
@@ -48,6 +57,8 @@ struct Entity {
         for (int i = 0; i < MAX_NODES; ++i) {
             nodes[i] = {0.0f, 0.0f};
             nodesRel[i] = {0.0f, 0.0f};
+            nodeIds[i] = (Uint8)i;
+            nodeSlots[i] = (Uint8)i;
         }
     }
 
@@ -60,13 +71,17 @@ struct Entity {
         : shapetype(other.shapetype), Xpos(other.Xpos), Ypos(other.Ypos),
           Xvel(other.Xvel), Yvel(other.Yvel), width(other.width), height(other.height),
           size(other.size), onGround(other.onGround), color(other.color),
-          nodeCount(other.nodeCount), isCore(other.isCore), isHandOrFoot(other.isHandOrFoot), isLeg(other.isLeg), grabbing(other.grabbing),
+          texture(other.texture), textureRect(other.textureRect), sharedTexture(other.sharedTexture),
+          spriteDirty(other.spriteDirty), nodeCount(other.nodeCount), isCore(other.isCore), isHandOrFoot(other.isHandOrFoot), isLeg(other.isLeg), grabbing(other.grabbing),
           coreNodeIndex(other.coreNodeIndex), offsetX(other.offsetX), offsetY(other.offsetY),
           rotation(other.rotation), grabbedObject(other.grabbedObject), appendages(std::move(other.appendages)) {
         for (int i = 0; i < MAX_NODES; ++i) {
             nodes[i] = other.nodes[i];
             nodesRel[i] = other.nodesRel[i];
+            nodeIds[i] = other.nodeIds[i];
+            nodeSlots[i] = other.nodeSlots[i];
         }
+        other.texture = nullptr;
     }
 
     // Move assignment operator
@@ -82,6 +97,11 @@ struct Entity {
             size = other.size;
             onGround = other.onGround;
             color = other.color;
+            texture = other.texture;
+            textureRect = other.textureRect;
+            sharedTexture = other.sharedTexture;
+            spriteDirty = other.spriteDirty;
+            other.texture = nullptr;
             nodeCount = other.nodeCount;
             isCore = other.isCore;
             isHandOrFoot = other.isHandOrFoot;
@@ -96,6 +116,8 @@ struct Entity {
             for (int i = 0; i < MAX_NODES; ++i) {
                 nodes[i] = other.nodes[i];
                 nodesRel[i] = other.nodesRel[i];
+                nodeIds[i] = other.nodeIds[i];
+                nodeSlots[i] = other.nodeSlots[i];
             }
         }
         return *this;
@@ -103,13 +125,16 @@ struct Entity {
 };
 class Renderer;
 void initEntity(Entity* entity, Renderer* renderer, float Xpos, float Ypos, int width, int height, Shape shape, SDL_Color color, int size, bool isHandOrFoot, bool generateNodes = true);
-bool pointInRectangle(float px, float py, Entity* entity);
-bool pointInCircle(float px, float py, Entity* entity);
-bool pointInTriangle(float px, float py, Entity* entity);
 bool pointInEntityShape(float px, float py, Entity* entity);
 NodeRel absoluteToRelative(Entity* entity, float abs_x, float abs_y);
 SDL_FPoint relativeToAbsolute(Entity* entity, NodeRel nodeRel);
 void GenerateNodes(Entity* entity);
+// Node IDs equal to the node indices again, after nodes were replaced wholesale
+void resetNodeIds(Entity* entity);
+// Index of the node with the given ID, -1 if there is none
+int findNodeIndex(const Entity* entity, int nodeId);
+// Moves the last node into the gap, appendages on the removed node are left dangling
+void removeNodeById(Entity* entity, int nodeId);
 void updateNodePositions(Entity* entity);
 SDL_FPoint clampNodeToShape(SDL_FPoint pt, Entity* entity);
 NodeRel clampRelativeNodeToShape(NodeRel rel, Entity* entity);
@@ -117,8 +142,10 @@ void switchShape(Entity* entity, Shape newShape);
 void updateAppendagePositions(Entity* entity);
 bool addNodeToEntity(Entity* entity, float mouseX, float mouseY);
 bool shouldRemoveAppendage(const std::unique_ptr<Entity>& entity);
-void removeNodeFromEntity(Entity* entity, float mouseX, float mouseY);
-Entity* findAppendageAtPoint(Entity* entity, float px, float py);
+// Node and the appendages hanging on it (CreatureBVH finds the node under the pointer)
+void removeNodeFromEntity(Entity* entity, int nodeIndex);
 bool isEntityOnGround(Entity* entity, float groundY);
+SDL_FRect getShapeBounds(Entity* entity);
+SDL_FRect getEntityBounds(Entity* entity);
 void destroyEntity(Entity* entity);
 #endif // ENTITY_H
\ No newline at end of file
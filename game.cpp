@@ -11,6 +11,7 @@
 
 Game::Game()
     : window_(nullptr),
+      offscreen_(nullptr),
       sdl_renderer_(nullptr),
       renderer_(nullptr),
       inputManager_(this),
@@ -18,50 +19,134 @@ Game::Game()
       lastStepTime_(0),
       currentStepFoot_(0),
       walkCycle_(0.0f),
-      lastFrameTime_(0)
+      simAccumulator_(0),
+      sceneSignature_(0),
+      quietFrames_(0),
+      lateLatch_(true),
+      simStep_(0),
+      replaying_(false),
+      lastPointerEvent_(0),
+      uiStaticVersion_(-1),
+      camera_(SCREEN_WIDTH, SCREEN_HEIGHT),
+      cameraFollow_(true),
+      minimapEnabled_(false),
+      peakVertexCount_(0),
+      spriteCache_(&renderer_),
+      spriteCacheEnabled_(false),
+      softRasterRequested_(false),
+      headless_(false),
+      dynamicResolution_(&renderer_),
+      frameLimit_(0),
+      pipelined_(true),
+      recordOffline_(false),
+      scenePath_("scene.sdlc"),
+      libraryIndex_(0)
 {
 }
 
 Game::~Game() {
+    if (inputManager_.isQuitRequested()) saveScene();
+    recorder_.stop();
+    if (inputLog_.isWriting()) {
+        inputLog_.close(simStep_);
+        printf("Input log %s: %u steps, state checksum %016llx\n", inputLogPath_.c_str(), simStep_,
+               (unsigned long long)stateChecksum());
+    }
     destroyEntity(&player_);
     destroyEntity(&grabbableBall_);
+    spriteCache_.clear();
+    if (softRaster_) softRaster_->destroyTexture();
+    dynamicResolution_.destroy();
     if (sdl_renderer_) SDL_DestroyRenderer(sdl_renderer_);
     if (window_) SDL_DestroyWindow(window_);
+    if (offscreen_) SDL_DestroySurface(offscreen_);
     SDL_Quit();
 }
 
 bool Game::init() {
+    if (headless_) {
+        // Events still need a video driver, the offscreen one needs no display
+        SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+    }
     if (!SDL_Init(SDL_INIT_VIDEO)) {
         printf("SDL_Init Error: %s\n", SDL_GetError());
         return false;
     }
-    window_ = SDL_CreateWindow("Game", SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_RESIZABLE);
-    if (!window_) {
-        printf("SDL_CreateWindow Error: %s\n", SDL_GetError());
-        SDL_Quit();
-        return false;
+    if (headless_) {
+        // Software renderer on a plain surface: no window, same pixels on every machine
+        offscreen_ = SDL_CreateSurface(SCREEN_WIDTH, SCREEN_HEIGHT, SDL_PIXELFORMAT_ARGB8888);
+        if (!offscreen_) {
+            printf("SDL_CreateSurface Error: %s\n", SDL_GetError());
+            SDL_Quit();
+            return false;
+        }
+        sdl_renderer_ = SDL_CreateSoftwareRenderer(offscreen_);
+        if (!sdl_renderer_) {
+            printf("SDL_CreateSoftwareRenderer Error: %s\n", SDL_GetError());
+            SDL_DestroySurface(offscreen_);
+            offscreen_ = nullptr;
+            SDL_Quit();
+            return false;
+        }
+    } else {
+        window_ = SDL_CreateWindow("Game", SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_RESIZABLE);
+        if (!window_) {
+            printf("SDL_CreateWindow Error: %s\n", SDL_GetError());
+            SDL_Quit();
+            return false;
+        }
+        sdl_renderer_ = SDL_CreateRenderer(window_, nullptr);
+        if (!sdl_renderer_) {
+            printf("SDL_CreateRenderer Error: %s\n", SDL_GetError());
+            SDL_DestroyWindow(window_);
+            SDL_Quit();
+            return false;
+        }
+        if (SDL_SetRenderVSync(sdl_renderer_, true)) {
+            pacer_.setVSync(true);
+        } else {
+            printf("SDL_SetRenderVSync Warning: %s\n", SDL_GetError());
+        }
+        updateRefreshRate();
     }
-    sdl_renderer_ = SDL_CreateRenderer(window_, nullptr);
-    if (!sdl_renderer_) {
-        printf("SDL_CreateRenderer Error: %s\n", SDL_GetError());
-        SDL_DestroyWindow(window_);
-        SDL_Quit();
-        return false;
+    renderer_ = Renderer(sdl_renderer_);
+    if (softRasterRequested_) {
+        int w = SCREEN_WIDTH, h = SCREEN_HEIGHT;
+        SDL_GetRenderOutputSize(sdl_renderer_, &w, &h);
+        softRaster_ = std::make_unique<SoftRasterizer>();
+        softRaster_->resize(w, h);
+        renderer_.setSoftRasterizer(softRaster_.get());
+        printf("Software rasterizer: %d threads, %s\n", softRaster_->getThreadCount(), softRaster_->getSimdName());
     }
-    if (!SDL_SetRenderVSync(sdl_renderer_, true)) {
-        printf("SDL_SetRenderVSync Warning: %s\n", SDL_GetError());
+    if (pipelined_ && !headless_) {
+        pipeline_ = std::make_unique<RenderPipeline>();
     }
-    renderer_ = Renderer(sdl_renderer_);
+    if (!inputLogPath_.empty()) {
+        if (replaying_) {
+            if (!inputLog_.openRead(inputLogPath_)) return false;
+            // Mouse positions map to the world through the recorded window size
+            onWindowResized(inputLog_.getWindowWidth(), inputLog_.getWindowHeight());
+        } else if (inputLog_.openWrite(inputLogPath_, SCREEN_WIDTH, SCREEN_HEIGHT)) {
+            inputManager_.setInputLog(&inputLog_);
+        }
+    }
+    if (!recordDirectory_.empty()) {
+        int w = SCREEN_WIDTH, h = SCREEN_HEIGHT;
+        renderer_.getOutputSize(&w, &h);
+        recorder_.start(recordDirectory_, w, h, recordOffline_);
+    }
+    // Golden images need full resolution, the CPU rasterizer has no render targets
+    dynamicResolution_.setEnabled(!headless_ && !softRaster_);
 
-    initEntity(&player_, &renderer_, SCREEN_WIDTH/2, SCREEN_HEIGHT/2, 50, 50, Shape::TRIANGLE, {255, 0, 0, 255}, 50, false, true);
+    initEntity(&player_, &renderer_, WORLD_WIDTH/2, WORLD_HEIGHT - SCREEN_HEIGHT/2, 50, 50, Shape::TRIANGLE, {255, 0, 0, 255}, 50, false, true);
     player_.isCore = true;
     
     if (player_.texture) {
         renderer_.setTextureScaleMode(player_.texture, SDL_SCALEMODE_LINEAR);
     }
 
-    float ballX = SCREEN_WIDTH - 60;
-    float ballY = SCREEN_HEIGHT - 100; // Adjusted to start higher for visibility
+    float ballX = player_.Xpos + SCREEN_WIDTH/2 - 60;
+    float ballY = WORLD_HEIGHT - 100; // Adjusted to start higher for visibility
     int ballRadius = 30;
     initEntity(&grabbableBall_, &renderer_, ballX, ballY, ballRadius * 2, ballRadius * 2, Shape::CIRCLE, {0, 200, 255, 255}, ballRadius * 2, false, false);
     grabbableBall_.isCore = false;
@@ -69,6 +154,23 @@ bool Game::init() {
     grabbableBall_.Yvel = 0.0f;
 
     grabbableEntities_.push_back(&grabbableBall_);
+    if (usesScene() && SDL_GetPathInfo(scenePath_.c_str(), nullptr)) {
+        CreatureLibrary scene;
+        if (scene.open(scenePath_)) {
+            // Creature 0 is the player, 1 the ball
+            if (scene.instantiate(0, &player_)) player_.isCore = true;
+            scene.instantiate(1, &grabbableBall_);
+        }
+    }
+    if (!libraryPath_.empty()) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        if (library_.open(libraryPath_)) {
+            printf("Creature library: %d designs mapped in %.3f ms\n", library_.getCreatureCount(),
+                   (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+        }
+    }
+    camera_.setCenter(player_.Xpos, player_.Ypos);
+    bakedPlayer_.bake(&player_); // The editor starts closed
 
     logDebug("Player initialized at x=%.2f, y=%.2f, texture=%p\n", player_.Xpos, player_.Ypos, player_.texture);
     logDebug("Grabbable ball initialized at x=%.2f, y=%.2f, nodeCount=%d\n", grabbableBall_.Xpos, grabbableBall_.Ypos, grabbableBall_.nodeCount);
@@ -87,98 +189,163 @@ Entity* Game::findParent(Entity* root, Entity* target)
     return nullptr;
 }
 
-void Game::updateHands(Entity* entity) {
+// Reach from the parent node toward the target, clamped to the arm length. Returns the
+// unclamped distance.
+static float armReach(float nodeX, float nodeY, float targetX, float targetY, float& dx, float& dy) {
+    dx = targetX - nodeX;
+    dy = targetY - nodeY;
+    float dist = std::sqrt(dx * dx + dy * dy);
+
+    // Clamp arm length
+    float maxArmLength = 120.0f;
+    if (dist > maxArmLength) {
+        dx *= maxArmLength / dist;
+        dy *= maxArmLength / dist;
+    }
+    return dist;
+}
+
+// Grab logic and pose of the steered hands, once per simulation step
+void Game::updateHands() {
     // Use InputManager’s tracked state instead of SDL_GetMouseState
     bool isLeftMouseDown = inputManager_.isLeftMouseHeld();
 
-    for (auto& app : entity->appendages) {
-        if (app->isHandOrFoot && app->shapetype == Shape::TRIANGLE && !inputManager_.getInventoryOpen()) {
-            float nodeX = 0.0f, nodeY = 0.0f;
-            if (findParentNodePosition(app.get(), nodeX, nodeY)) {
-                float dx = inputManager_.getMouseX() - nodeX;
-                float dy = inputManager_.getMouseY() - nodeY;
-                float dist = std::sqrt(dx * dx + dy * dy);
-
-                // Clamp arm length
-                float maxArmLength = 120.0f;
-                if (dist > maxArmLength) {
-                    dx *= maxArmLength / dist;
-                    dy *= maxArmLength / dist;
-                }
-
-                bool wasGrabbing = app->grabbing;
-                app->grabbing = isLeftMouseDown;  // follow InputManager state
-
-                if (!app->grabbing && app->grabbedObject) {
-                    // Release immediately on mouse up
-                    app->grabbedObject = nullptr;
-                    logDebug("Released grabbed object\n");
-                }
-                else if (app->grabbing && !wasGrabbing) {
-                    // Just started grabbing
-                    app->offsetX = dx;
-                    app->offsetY = dy;
-
-                    float handX = nodeX + app->offsetX;
-                    float handY = nodeY + app->offsetY;
-
-                    app->grabbedObject = getGrabbableAt(handX, handY, 15.0f);
-                    if (app->grabbedObject) {
-                        logDebug("Hand at (%.2f, %.2f) grabbed object at (%.2f, %.2f)\n",
-                                 handX, handY,
-                                 app->grabbedObject->Xpos, app->grabbedObject->Ypos);
-                    }
-                }
-
-                // Smooth movement interpolation
-                float handLerp = std::clamp(dist / 60.0f, 0.15f, 0.7f);
-                app->offsetX += (dx - app->offsetX) * handLerp;
-                app->offsetY += (dy - app->offsetY) * handLerp;
-                app->rotation = std::atan2(dy, dx);
-
-                // While grabbing, drag object along with hand
-                if (app->grabbing && app->grabbedObject) {
-                    app->grabbedObject->Xpos = nodeX + app->offsetX;
-                    app->grabbedObject->Ypos = nodeY + app->offsetY;
-                    app->grabbedObject->Xvel = 0.0f;
-                    app->grabbedObject->Yvel = 0.0f;
-                }
-
-                // Update appendage position based on offsets
-                app->Xpos = nodeX + app->offsetX;
-                app->Ypos = nodeY + app->offsetY;
-            }
+    const std::vector<int>& hands = bakedPlayer_.getSteeredHands();
+    handSteps_.resize(hands.size());
+    grabSlots_.clear();
+    grabX_.clear();
+    grabY_.clear();
+    for (int slot = 0; slot < (int)hands.size(); ++slot) {
+        HandStep& step = handSteps_[slot];
+        step.attached = bakedPlayer_.getAttachPoint(hands[slot], step.node);
+        if (!step.attached) continue;
+        CreaturePose& pose = bakedPlayer_.getPose(hands[slot]);
+        CreatureHand& hand = bakedPlayer_.getHand(slot);
+        step.dist = armReach(step.node.x, step.node.y, inputManager_.getMouseWorldX(), inputManager_.getMouseWorldY(),
+                             step.dx, step.dy);
+
+        bool wasGrabbing = hand.grabbing;
+        hand.grabbing = isLeftMouseDown;  // follow InputManager state
+
+        if (!hand.grabbing && hand.grabbedObject) {
+            // Release immediately on mouse up
+            hand.grabbedObject = nullptr;
+            logDebug("Released grabbed object\n");
+        }
+        else if (hand.grabbing && !wasGrabbing) {
+            // Just started grabbing
+            pose.offsetX = step.dx;
+            pose.offsetY = step.dy;
+
+            grabSlots_.push_back(slot);
+            grabX_.push_back(step.node.x + pose.offsetX);
+            grabY_.push_back(step.node.y + pose.offsetY);
+        }
+    }
+
+    // All new grabs in one batch query, before any hand drags what it holds
+    grabFound_.resize(grabSlots_.size());
+    getGrabbablesAt(grabX_.data(), grabY_.data(), (int)grabSlots_.size(), 15.0f, grabFound_.data());
+    for (int i = 0; i < (int)grabSlots_.size(); ++i) {
+        CreatureHand& hand = bakedPlayer_.getHand(grabSlots_[i]);
+        hand.grabbedObject = grabFound_[i];
+        if (hand.grabbedObject) {
+            logDebug("Hand at (%.2f, %.2f) grabbed object at (%.2f, %.2f)\n",
+                     grabX_[i], grabY_[i],
+                     hand.grabbedObject->Xpos, hand.grabbedObject->Ypos);
         }
-        updateHands(app.get());
+    }
+
+    for (int slot = 0; slot < (int)hands.size(); ++slot) {
+        const HandStep& step = handSteps_[slot];
+        if (!step.attached) continue;
+        solveHandPose(bakedPlayer_.getPose(hands[slot]), bakedPlayer_.getHand(slot), step.node.x, step.node.y,
+                      step.dx, step.dy, step.dist);
     }
 }
 
+void Game::solveHandPose(CreaturePose& pose, const CreatureHand& hand, float nodeX, float nodeY, float dx, float dy, float dist) {
+    // Smooth movement interpolation
+    float handLerp = std::clamp(dist / 60.0f, 0.15f, 0.7f);
+    pose.offsetX += (dx - pose.offsetX) * handLerp;
+    pose.offsetY += (dy - pose.offsetY) * handLerp;
+    pose.rotation = std::atan2(dy, dx);
+
+    // While grabbing, drag object along with hand
+    if (hand.grabbing && hand.grabbedObject) {
+        hand.grabbedObject->Xpos = nodeX + pose.offsetX;
+        hand.grabbedObject->Ypos = nodeY + pose.offsetY;
+        hand.grabbedObject->Xvel = 0.0f;
+        hand.grabbedObject->Yvel = 0.0f;
+    }
 
+    // Update appendage position based on offsets
+    pose.x = nodeX + pose.offsetX;
+    pose.y = nodeY + pose.offsetY;
+}
 
-Entity* Game::getGrabbableAt(float x, float y, float tolerance) {
-    if (std::abs(y - 700.0f) < tolerance) {
-        return nullptr;
+// Late latching: right before the frame is captured, the hands take one more pose
+// step toward the freshest pointer position. Only for display, restoreLatchedHands()
+// puts the simulated pose back once the snapshot has copied it.
+void Game::latchHands(float targetX, float targetY) {
+    const std::vector<int>& hands = bakedPlayer_.getSteeredHands();
+    for (int slot = 0; slot < (int)hands.size(); ++slot) {
+        SDL_FPoint node;
+        if (!bakedPlayer_.getAttachPoint(hands[slot], node)) continue;
+        CreaturePose& pose = bakedPlayer_.getPose(hands[slot]);
+        const CreatureHand& hand = bakedPlayer_.getHand(slot);
+        Entity* grabbed = hand.grabbing ? hand.grabbedObject : nullptr;
+        latchedHands_.push_back({slot, pose,
+                                 grabbed ? grabbed->Xpos : 0.0f, grabbed ? grabbed->Ypos : 0.0f,
+                                 grabbed ? grabbed->Xvel : 0.0f, grabbed ? grabbed->Yvel : 0.0f});
+        float dx = 0.0f, dy = 0.0f;
+        float dist = armReach(node.x, node.y, targetX, targetY, dx, dy);
+        solveHandPose(pose, hand, node.x, node.y, dx, dy, dist);
     }
-    for (Entity* obj : grabbableEntities_) {
-        float dx = x - obj->Xpos;
-        float dy = y - obj->Ypos;
-        float dist = std::sqrt(dx * dx + dy * dy);
-        if (dist < obj->width / 2.0f + tolerance) {
-            return obj;
+}
+
+void Game::restoreLatchedHands() {
+    // Backwards, in case two hands hold the same object
+    for (auto it = latchedHands_.rbegin(); it != latchedHands_.rend(); ++it) {
+        bakedPlayer_.getPose(bakedPlayer_.getSteeredHands()[it->slot]) = it->pose;
+        const CreatureHand& hand = bakedPlayer_.getHand(it->slot);
+        if (hand.grabbing && hand.grabbedObject) {
+            hand.grabbedObject->Xpos = it->grabbedX;
+            hand.grabbedObject->Ypos = it->grabbedY;
+            hand.grabbedObject->Xvel = it->grabbedXvel;
+            hand.grabbedObject->Yvel = it->grabbedYvel;
         }
     }
-    return nullptr;
+    latchedHands_.clear();
+}
+
+
+
+void Game::getGrabbablesAt(const float* x, const float* y, int count, float tolerance, Entity** found) {
+    if (count == 0) return;
+    // Every grabbable is reached like a circle of its width
+    grabBatch_.clear(CIRCLE);
+    for (Entity* obj : grabbableEntities_) {
+        grabBatch_.add(obj, tolerance);
+    }
+    grabHits_.resize(count);
+    pointsInShapes(grabBatch_, x, y, count, grabHits_.data());
+    for (int i = 0; i < count; ++i) {
+        bool atGround = std::abs(y[i] - WORLD_HEIGHT) < tolerance;
+        found[i] = grabHits_[i] >= 0 && !atGround ? grabbableEntities_[grabHits_[i]] : nullptr;
+    }
 }
 
 void Game::update() {
     if (!inputManager_.getInventoryOpen()) {
+        if (!bakedPlayer_.isBaked()) rebakePlayer();
         // Update player
         player_.Yvel += GRAVITY;
         player_.Ypos += player_.Yvel;
 
-        float lowestY = getLowestEntityY(&player_);
-        if (lowestY >= SCREEN_HEIGHT) {
-            player_.Ypos -= (lowestY - SCREEN_HEIGHT);
+        float lowestY = bakedPlayer_.getLowestY();
+        if (lowestY >= WORLD_HEIGHT) {
+            player_.Ypos -= (lowestY - WORLD_HEIGHT);
             player_.Yvel = 0.0f;
             player_.onGround = true;
             logDebug("Ground collision: adjusted player Ypos=%.2f, Yvel=0\n", player_.Ypos);
@@ -190,19 +357,19 @@ void Game::update() {
 
         float minX = std::numeric_limits<float>::max();
         float maxX = std::numeric_limits<float>::lowest();
-        getEntityMinMaxX(&player_, minX, maxX);
+        bakedPlayer_.getMinMaxX(minX, maxX);
 
         if (minX < 0.0f) {
             player_.Xpos -= minX;
         }
-        if (maxX > SCREEN_WIDTH) {
-            player_.Xpos -= (maxX - SCREEN_WIDTH);
+        if (maxX > WORLD_WIDTH) {
+            player_.Xpos -= (maxX - WORLD_WIDTH);
         }
 
         // Update grabbable ball (if not grabbed)
         bool isBallGrabbed = false;
-        for (auto& app : player_.appendages) {
-            if (app->grabbedObject == &grabbableBall_) {
+        for (int slot = 0; slot < (int)bakedPlayer_.getSteeredHands().size(); ++slot) {
+            if (bakedPlayer_.getHand(slot).grabbedObject == &grabbableBall_) {
                 isBallGrabbed = true;
                 break;
             }
@@ -210,8 +377,8 @@ void Game::update() {
         if (!isBallGrabbed) {
             grabbableBall_.Yvel += GRAVITY;
             grabbableBall_.Ypos += grabbableBall_.Yvel;
-            if (grabbableBall_.Ypos + grabbableBall_.height / 2.0f >= SCREEN_HEIGHT) {
-                grabbableBall_.Ypos = SCREEN_HEIGHT - grabbableBall_.height / 2.0f;
+            if (grabbableBall_.Ypos + grabbableBall_.height / 2.0f >= WORLD_HEIGHT) {
+                grabbableBall_.Ypos = WORLD_HEIGHT - grabbableBall_.height / 2.0f;
                 grabbableBall_.Yvel = 0.0f;
                 grabbableBall_.onGround = true;
                 logDebug("Ball ground collision: Ypos=%.2f, Yvel=0\n", grabbableBall_.Ypos);
@@ -230,7 +397,7 @@ void Game::update() {
     }
 
     if (inputManager_.getJumpRequested() && player_.onGround && !inputManager_.getInventoryOpen()) {
-        int numLegs = getFeet(&player_).size();
+        int numLegs = (int)bakedPlayer_.getFeet().size();
         float baseJumpPower = -50.0f;
         float jumpPower = baseJumpPower * std::max(1, numLegs); // At least 1 leg
         player_.Yvel = jumpPower;
@@ -240,66 +407,102 @@ void Game::update() {
     }
 
     if (std::abs(player_.Xvel) > 0.0f && player_.onGround) {
-        updateWalkingAnimation(&player_);
+        updateWalkingAnimation();
     } else {
         walkCycle_ = 0.0f;
     }
 
-    updateNodePositions(&player_);
-    updateAppendagePositions(&player_);
-    updateHands(&player_);
+    if (bakedPlayer_.isBaked()) {
+        bakedPlayer_.updatePose();
+        updateHands();
+    } else {
+        updateNodePositions(&player_);
+        updateAppendagePositions(&player_);
+    }
+
+    if (!inputManager_.getInventoryOpen()) {
+        updateCrowd();
+    }
+
+    if (cameraFollow_) {
+        camera_.setCenter(player_.Xpos, player_.Ypos);
+    }
 }
 
-void Game::updateWalkingAnimation(Entity* entity) {
-    Uint32 currentTime = SDL_GetTicks();
-    if (currentTime - lastStepTime_ >= STEP_INTERVAL) {
-        std::vector<Entity*> feet = getFeet(entity);
-        if (!feet.empty()) {
-            Entity* foot = feet[currentStepFoot_ % feet.size()];
-            foot->rotation = sin(walkCycle_) * 0.2f;
-            walkCycle_ += 0.1f;
-            currentStepFoot_ = (currentStepFoot_ + 1) % feet.size();
-            lastStepTime_ = currentTime;
+// Same ground and wall handling as the player, on the pose arrays
+void Game::updateCrowd() {
+    for (CreatureInstance& creature : crowd_) {
+        const CreatureBlueprint& blueprint = *creature.blueprint;
+        CreaturePose* poses = creature.poses.data();
+        creature.yvel += GRAVITY;
+        poses[0].x += creature.xvel;
+        poses[0].y += creature.yvel;
+        blueprint.updatePose(poses);
+
+        float dx = 0.0f, dy = 0.0f;
+        float lowestY = blueprint.getLowestY(poses);
+        creature.onGround = lowestY >= WORLD_HEIGHT;
+        if (creature.onGround) {
+            dy = WORLD_HEIGHT - lowestY;
+            creature.yvel = 0.0f;
+        }
+        float minX = std::numeric_limits<float>::max();
+        float maxX = std::numeric_limits<float>::lowest();
+        blueprint.getMinMaxX(poses, minX, maxX);
+        if (minX < 0.0f) {
+            dx = -minX;
+        } else if (maxX > WORLD_WIDTH) {
+            dx = WORLD_WIDTH - maxX;
+        }
+        if (dx != 0.0f || dy != 0.0f) {
+            for (CreaturePose& pose : creature.poses) {
+                pose.x += dx;
+                pose.y += dy;
+            }
         }
     }
 }
 
-std::vector<Entity*> Game::getFeet(Entity* entity) {
-    std::vector<Entity*> feet;
-    for (auto& app : entity->appendages) {
-        if (app->isHandOrFoot && app->isLeg) {
-            feet.push_back(app.get());
+void Game::spawnCrowd(int count) {
+    if (!bakedPlayer_.isBaked() || count <= 0) return;
+    std::shared_ptr<const CreatureBlueprint> design = bakedPlayer_.shareBlueprint();
+    SDL_FRect bounds = bakedPlayer_.getBounds();
+    float spacing = bounds.w + 20.0f;
+    // After the last instance of the same design, or at the end for a new one
+    size_t insertAt = crowd_.size();
+    for (size_t i = crowd_.size(); i-- > 0;) {
+        if (crowd_[i].blueprint == design) {
+            insertAt = i + 1;
+            break;
         }
-        auto subFeet = getFeet(app.get());
-        feet.insert(feet.end(), subFeet.begin(), subFeet.end());
     }
-    return feet;
-}
+    std::vector<CreatureInstance> spawned(count);
+    for (int i = 0; i < count; ++i) {
+        float x = std::fmod(player_.Xpos + spacing * (float)(crowd_.size() + i + 1), (float)WORLD_WIDTH);
+        spawned[i].spawn(design, x, player_.Ypos);
+    }
+    crowd_.insert(crowd_.begin() + insertAt, spawned.begin(), spawned.end());
 
-float Game::getLowestEntityY(Entity* entity) {
-    float lowestY = entity->Ypos + entity->height / 2.0f;
-    for (auto& app : entity->appendages) {
-        lowestY = std::max(lowestY, getLowestEntityY(app.get()));
+    size_t instanceBytes = 0;
+    for (const CreatureInstance& creature : crowd_) {
+        instanceBytes += creature.getMemoryUsage();
     }
-    return lowestY;
+    printf("Crowd: %d creatures, %zu bytes per instance on average, %zu bytes of shared blueprint (%d parts)\n",
+           (int)crowd_.size(), instanceBytes / crowd_.size(), design->getMemoryUsage(), design->getPartCount());
 }
 
-void Game::getEntityMinMaxX(Entity* entity, float& minX, float& maxX) {
-    float hw = entity->width / 2.0f;
-    float cx = entity->Xpos;
-    float cy = entity->Ypos;
-    float rot = entity->rotation;
-    SDL_FPoint points[4] = {
-        {-hw, -hw}, {hw, -hw}, {hw, hw}, {-hw, hw}
-    };
-    for (int i = 0; i < 4; ++i) {
-        float rx = points[i].x * cos(rot) - points[i].y * sin(rot);
-        float x = cx + rx;
-        minX = std::min(minX, x);
-        maxX = std::max(maxX, x);
-    }
-    for (auto& app : entity->appendages) {
-        getEntityMinMaxX(app.get(), minX, maxX);
+void Game::updateWalkingAnimation() {
+    // Simulation time, so replays step the same way
+    Uint32 currentTime = (Uint32)(simStep_ * 1000ull / SIM_HZ);
+    if (currentTime - lastStepTime_ >= STEP_INTERVAL) {
+        const std::vector<int>& feet = bakedPlayer_.getFeet();
+        if (!feet.empty()) {
+            CreaturePose& foot = bakedPlayer_.getPose(feet[currentStepFoot_ % feet.size()]);
+            foot.rotation = sin(walkCycle_) * 0.2f;
+            walkCycle_ += 0.1f;
+            currentStepFoot_ = (currentStepFoot_ + 1) % feet.size();
+            lastStepTime_ = currentTime;
+        }
     }
 }
 
@@ -315,9 +518,10 @@ bool Game::findParentNodePosition(Entity* appendage, float& nodeX, float& nodeY)
     if (!appendage || appendage->coreNodeIndex < 0) return false;
     
     Entity* parent = findParent(&player_, appendage);
-    if (parent) {
-        nodeX = parent->nodes[appendage->coreNodeIndex].x;
-        nodeY = parent->nodes[appendage->coreNodeIndex].y;
+    int node = parent ? findNodeIndex(parent, appendage->coreNodeIndex) : -1;
+    if (node >= 0) {
+        nodeX = parent->nodes[node].x;
+        nodeY = parent->nodes[node].y;
         return true;
     }
     return false;
@@ -336,101 +540,629 @@ float Game::distanceSquared(float x1, float y1, float x2, float y2) const {
 void Game::renderUI() {
     if (!inputManager_.getInventoryOpen()) return;
 
-    RenderData uiData;
-    renderer_.collectUIGeometry(inputManager_.getShapeButtons(),
-                              inputManager_.getEditModeButtons(),
-                              inputManager_.getAddNodeButton(),
-                              inputManager_.getRemoveNodeButton(),
-                              uiData);
-    renderer_.renderBatchedGeometry(uiData);
+    if (uiStaticVersion_ != inputManager_.getLayoutVersion()) {
+        uiStaticData_.clear();
+        renderer_.collectUIGeometry(inputManager_.getShapeButtons(),
+                                  inputManager_.getEditModeButtons(),
+                                  inputManager_.getAddNodeButton(),
+                                  inputManager_.getRemoveNodeButton(),
+                                  uiStaticData_);
+        uiStaticVersion_ = inputManager_.getLayoutVersion();
+    }
+    drawList_.addStatic(DrawLayer::UI, &uiStaticData_);
 
-    renderer_.setDrawColor({255, 255, 255, 255});
+    const SDL_Color highlight = {255, 255, 255, 255};
     for (const auto& btn : inputManager_.getShapeButtons()) {
         if ((inputManager_.getCurrentMode() == InputManager::EditMode::TORSO && btn.shapeType == player_.shapetype) ||
             ((inputManager_.getCurrentMode() == InputManager::EditMode::APPENDAGE || 
               inputManager_.getCurrentMode() == InputManager::EditMode::HANDS_FEET) && 
              btn.shapeType == inputManager_.getCurrentShape() && inputManager_.getShapeSelectedForAppendage())) {
-            renderer_.drawRect(&btn.rect);
+            drawList_.rectOutline(DrawLayer::UI_OVERLAY, btn.rect, highlight);
         }
     }
     if (inputManager_.getCurrentMode() != InputManager::EditMode::HANDS_FEET) {
-        if (inputManager_.getPlacingNode()) renderer_.drawRect(&inputManager_.getAddNodeButton().rect);
-        if (inputManager_.getRemovingNode()) renderer_.drawRect(&inputManager_.getRemoveNodeButton().rect);
+        if (inputManager_.getPlacingNode()) drawList_.rectOutline(DrawLayer::UI_OVERLAY, inputManager_.getAddNodeButton().rect, highlight);
+        if (inputManager_.getRemovingNode()) drawList_.rectOutline(DrawLayer::UI_OVERLAY, inputManager_.getRemoveNodeButton().rect, highlight);
     }
     for (const auto& tab : inputManager_.getEditModeButtons()) {
         if (tab.mode == inputManager_.getCurrentMode()) {
-            renderer_.drawRect(&tab.rect);
+            drawList_.rectOutline(DrawLayer::UI_OVERLAY, tab.rect, highlight);
         }
     }
 }
 
-bool Game::addAppendageToEntity(Entity* entity, float mouseX, float mouseY, Shape shape, int& nodeIndex, Entity*& parentEntity, bool isHandOrFoot) {
-    if (!entity) return false;
-    for (int i = 0; i < entity->nodeCount; i++) {
-        float distance = distanceSquared(mouseX, mouseY, entity->nodes[i].x, entity->nodes[i].y);
-        logDebug("Checking node %d of entity at (%.2f, %.2f): x=%.2f, y=%.2f, distance=%.2f\n",
-                 i, entity->Xpos, entity->Ypos, entity->nodes[i].x, entity->nodes[i].y, sqrt(distance));
-        if (distance <= 100.0f) {
-            if (entity->appendages.size() >= MAX_APPENDAGES) {
-                logDebug("Appendage limit reached (%d) for entity at (%.2f, %.2f)\n", MAX_APPENDAGES, entity->Xpos, entity->Ypos);
-                return false;
-            }
-            Entity appendage(-1);
-            int width = 50;
-            int height = 50;
-            SDL_FPoint nodePos = {entity->nodes[i].x, entity->nodes[i].y};
-            float offset = 50;
-            initEntity(&appendage, &renderer_, nodePos.x, nodePos.y + offset, width, height, shape, {0, 255, 0, 255}, 50, isHandOrFoot);
-            appendage.isCore = false;
-            appendage.coreNodeIndex = i;
-            appendage.offsetX = 0.0f;
-            appendage.offsetY = offset;
-            appendage.isHandOrFoot = isHandOrFoot;
-            appendage.isLeg = isHandOrFoot && shape == Shape::RECTANGLE;
-            entity->appendages.push_back(std::make_unique<Entity>(std::move(appendage)));
-            nodeIndex = i;
-            parentEntity = entity;
-            logDebug("Added %s appendage (shape=%d, isHandOrFoot=%d, isLeg=%d) to node %d at x=%.2f, y=%.2f on entity at (%.2f, %.2f)\n",
-                     isHandOrFoot ? "hand/foot" : "regular", shape, isHandOrFoot, appendage.isLeg, i, nodePos.x, nodePos.y, entity->Xpos, entity->Ypos);
-            return true;
-        }
-    }
-    for (auto& app : entity->appendages) {
-        if (addAppendageToEntity(app.get(), mouseX, mouseY, shape, nodeIndex, parentEntity, isHandOrFoot)) {
-            return true;
-        }
+bool Game::attachAppendage(Entity* entity, int nodeIndex, Shape shape, bool isHandOrFoot) {
+    if (!entity || nodeIndex < 0 || nodeIndex >= entity->nodeCount) return false;
+    if (entity->appendages.size() >= MAX_APPENDAGES) {
+        logDebug("Appendage limit reached (%d) for entity at (%.2f, %.2f)\n", MAX_APPENDAGES, entity->Xpos, entity->Ypos);
+        return false;
     }
-    return false;
+    Entity appendage(-1);
+    int width = 50;
+    int height = 50;
+    SDL_FPoint nodePos = {entity->nodes[nodeIndex].x, entity->nodes[nodeIndex].y};
+    float offset = 50;
+    initEntity(&appendage, &renderer_, nodePos.x, nodePos.y + offset, width, height, shape, {0, 255, 0, 255}, 50, isHandOrFoot);
+    appendage.isCore = false;
+    appendage.coreNodeIndex = entity->nodeIds[nodeIndex];
+    appendage.offsetX = 0.0f;
+    appendage.offsetY = offset;
+    appendage.isHandOrFoot = isHandOrFoot;
+    appendage.isLeg = isHandOrFoot && shape == Shape::RECTANGLE;
+    entity->appendages.push_back(std::make_unique<Entity>(std::move(appendage)));
+    entity->spriteDirty = true;
+    invalidateEditBvh();
+    logDebug("Added %s appendage (shape=%d, isHandOrFoot=%d, isLeg=%d) to node %d at x=%.2f, y=%.2f on entity at (%.2f, %.2f)\n",
+             isHandOrFoot ? "hand/foot" : "regular", shape, isHandOrFoot, appendage.isLeg, nodeIndex, nodePos.x, nodePos.y, entity->Xpos, entity->Ypos);
+    return true;
+}
+
+bool Game::addAppendageAt(float mouseX, float mouseY, Shape shape, int& nodeIndex, Entity*& parentEntity, bool isHandOrFoot) {
+    CreatureBVH::NodeHit hit;
+    if (!getEditBvh().findNearestNode(mouseX, mouseY, NODE_PICK_RADIUS, hit)) return false;
+    if (!attachAppendage(hit.entity, hit.index, shape, isHandOrFoot)) return false;
+    nodeIndex = hit.index;
+    parentEntity = hit.entity;
+    return true;
+}
+
+bool Game::removeNodeAt(float x, float y) {
+    CreatureBVH::NodeHit hit;
+    if (!getEditBvh().findNearestNode(x, y, NODE_PICK_RADIUS, hit)) return false;
+    removeNodeFromEntity(hit.entity, hit.index);
+    invalidateEditBvh();
+    return true;
+}
+
+Entity* Game::pickAppendage(float x, float y) {
+    return getEditBvh().pickAppendage(x, y);
+}
+
+CreatureBVH& Game::getEditBvh() {
+    if (!editBvh_.isBuilt()) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        editBvh_.build(&player_);
+        logDebug("Built editor BVH over %d parts in %.3f ms\n", editBvh_.getPartCount(),
+                 (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+    }
+    return editBvh_;
+}
+
+// Quantized to 1/16 world unit, smaller changes are not visible
+static void hashValue(Uint64& hash, float value) {
+    Uint32 bits = (Uint32)(Sint32)std::lround(value * 16.0f);
+    for (int i = 0; i < 4; ++i) {
+        hash = (hash ^ ((bits >> (i * 8)) & 0xFF)) * 1099511628211ull; // FNV-1a
+    }
+}
+
+static void hashEntity(Uint64& hash, const Entity* entity) {
+    hashValue(hash, entity->Xpos);
+    hashValue(hash, entity->Ypos);
+    hashValue(hash, entity->rotation * 1024.0f);
+    hashValue(hash, (float)entity->width);
+    hashValue(hash, (float)entity->height);
+    hashValue(hash, (float)entity->shapetype);
+    hashValue(hash, (float)entity->nodeCount);
+    hashValue(hash, (float)entity->appendages.size());
+    Uint32 color = ((Uint32)entity->color.r << 24) | ((Uint32)entity->color.g << 16) | ((Uint32)entity->color.b << 8) | entity->color.a;
+    hash = (hash ^ color) * 1099511628211ull;
+    for (const auto& app : entity->appendages) {
+        hashEntity(hash, app.get());
+    }
+}
+
+// Everything a frame shows, for detecting that nothing changes anymore. UI state is
+// only changed by input, which counts as a change by itself.
+Uint64 Game::sceneSignature() const {
+    Uint64 hash = 14695981039346656037ull;
+    hashEntity(hash, &player_);
+    // While playing the tree below the root is stale, the baked pose moves instead
+    for (int i = 1; i < bakedPlayer_.getPartCount(); ++i) {
+        const CreaturePose& pose = bakedPlayer_.getPose(i);
+        hashValue(hash, pose.x);
+        hashValue(hash, pose.y);
+        hashValue(hash, pose.rotation * 1024.0f);
+    }
+    for (const CreatureInstance& creature : crowd_) {
+        hashValue(hash, creature.poses[0].x);
+        hashValue(hash, creature.poses[0].y);
+    }
+    hashEntity(hash, &grabbableBall_);
+    hashValue(hash, camera_.getCenterX());
+    hashValue(hash, camera_.getCenterY());
+    hashValue(hash, camera_.getZoom() * 1024.0f);
+    return hash;
+}
+
+bool Game::isIdle() const {
+    return !headless_ && frameLimit_ == 0 && !recorder_.isRecording() && quietFrames_ >= IDLE_AFTER_FRAMES;
 }
 
 void Game::run() {
-    lastFrameTime_ = SDL_GetTicks();
+    pacer_.start();
     bool running = true;
+    int frames = 0;
+    Uint64 workTicks = 0; // update + render, without the frame delay
+    Uint64 worstTicks = 0;
+    Uint64 frameTime = SIM_STEP_NS;
     while (running) {
-        inputManager_.handleEvents();
-        update();
-        render();
-        Uint32 currentTime = SDL_GetTicks();
-        Uint32 frameTime = currentTime - lastFrameTime_;
-        if (frameTime < FRAME_DELAY) {
-            SDL_Delay(FRAME_DELAY - frameTime);
+        // Nothing changed for a few frames: block until input arrives. The timeout keeps
+        // waking up so changes that don't come from input are still picked up.
+        int events = 0;
+        if (replaying_) {
+            // Input only comes from the log
+        } else if (isIdle()) {
+            events = inputManager_.waitEvents(IDLE_TIMEOUT_MS);
+            pacer_.resync();
+            frameTime = SIM_STEP_NS;
+        } else {
+            events = inputManager_.handleEvents();
         }
-        lastFrameTime_ = currentTime;
+        Uint64 workStart = SDL_GetPerformanceCounter();
+        // Minimized, hidden or unfocused windows run at the background rate, and only
+        // the visible ones draw
+        SDL_WindowFlags flags = window_ ? SDL_GetWindowFlags(window_) : 0;
+        bool hidden = flags & (SDL_WINDOW_MINIMIZED | SDL_WINDOW_HIDDEN | SDL_WINDOW_OCCLUDED);
+        pacer_.setThrottle(window_ && (hidden || !(flags & SDL_WINDOW_INPUT_FOCUS)) ? BACKGROUND_HZ : 0.0f);
+        // Headless runs (golden tests, offline recording) step once per frame so they
+        // are deterministic. Otherwise as many steps as the last frame took, where
+        // intervals within half a millisecond of the refresh period count as exactly
+        // one period, so vsync jitter doesn't alternate between 0 and 2 steps.
+        int steps = 1;
+        if (!headless_) {
+            Uint64 period = pacer_.getPeriod();
+            Uint64 jitter = frameTime > period ? frameTime - period : period - frameTime;
+            simAccumulator_ += jitter < SDL_NS_PER_MS / 2 ? period : frameTime;
+            steps = (int)(simAccumulator_ / SIM_STEP_NS);
+            if (steps > MAX_SIM_STEPS) {
+                steps = MAX_SIM_STEPS;
+                simAccumulator_ = 0;
+            } else {
+                simAccumulator_ -= steps * SIM_STEP_NS;
+            }
+        }
+        // Each step handles the input up to its own end time, so a tap between two
+        // steps lands in the same step at any frame rate. Later input waits for the
+        // next frame. Headless runs take everything.
+        Uint64 now = SDL_GetTicksNS();
+        for (int i = 0; i < steps && running; ++i) {
+            if (replaying_) {
+                running = replayStep();
+                if (!running) break;
+            }
+            Uint64 behind = simAccumulator_ + (Uint64)(steps - 1 - i) * SIM_STEP_NS;
+            Uint64 stepEnd = headless_ ? SDL_MAX_UINT64 : (now > behind ? now - behind : 0);
+            inputManager_.processEvents(stepEnd);
+            if (inputManager_.isQuitRequested()) {
+                // The step ends at the quit, like the recorded session did
+                running = false;
+                break;
+            }
+            update();
+            ++simStep_;
+        }
+        if (!running) {
+            printRunStats(frames, workTicks, worstTicks);
+            break;
+        }
+        Uint64 signature = sceneSignature();
+        if (events > 0 || signature != sceneSignature_) {
+            sceneSignature_ = signature;
+            quietFrames_ = 0;
+        } else {
+            ++quietFrames_;
+        }
+        // Past IDLE_AFTER_FRAMES quiet frames the pipeline has shown the last change, an
+        // idle wakeup without input has nothing new to draw
+        bool upToDate = isIdle() && quietFrames_ > IDLE_AFTER_FRAMES;
+        if (hidden || upToDate) {
+            // Nothing to draw into, or nothing new
+        } else if (pipeline_) {
+            renderPipelined();
+        } else {
+            render();
+        }
+        Uint64 work = SDL_GetPerformanceCounter() - workStart;
+        workTicks += work;
+        worstTicks = std::max(worstTicks, work);
+        if (frameLimit_ > 0 && ++frames >= frameLimit_) {
+            printRunStats(frames, workTicks, worstTicks);
+            running = false;
+        } else if (frameLimit_ <= 0) {
+            ++frames;
+        }
+        // Headless runs as fast as possible
+        if (headless_) continue;
+        frameTime = pacer_.wait();
+    }
+}
+
+void Game::printRunStats(int frames, Uint64 workTicks, Uint64 worstTicks) {
+    double toMs = 1000.0 / SDL_GetPerformanceFrequency();
+    if (frames > 0) {
+        printf("%d frames: %.3f ms/frame average, %.3f ms worst\n", frames, workTicks * toMs / frames, worstTicks * toMs);
+    }
+    if (latency_.samples > 0) {
+        printf("Pointer to present%s: %.3f ms average (%.3f ms from the handled event), %.3f ms worst\n",
+               lateLatch_ ? " (late latched)" : "", latency_.sampleSumMs / latency_.samples,
+               latency_.eventSumMs / latency_.samples, latency_.worstMs);
+    }
+    if (!headless_) {
+        printf("Pacing at %.2f Hz%s: %.3f ms average error, %.3f ms worst, %d missed frames\n",
+               pacer_.getRefreshRate(), pacer_.getVSync() ? " (vsync)" : "", pacer_.getAverageErrorMs(),
+               pacer_.getWorstErrorMs(), pacer_.getMissedFrames());
+    }
+    if (replaying_) {
+        printf("Replayed %u steps, state checksum %016llx\n", simStep_, (unsigned long long)stateChecksum());
+    }
+}
+
+// Queues the logged input of the coming step. Returns false once the log is done,
+// after its END step. The recorded quit is queued like the rest: the events before
+// it are handled, then run() stops the way the live session did.
+bool Game::replayStep() {
+    SDL_Event event;
+    while (inputLog_.read(simStep_, event)) {
+        inputManager_.queueReplayEvent(event);
+        if (event.type == SDL_EVENT_QUIT) return true;
+    }
+    return !(inputLog_.finished() && simStep_ >= inputLog_.getEndStep());
+}
+
+void Game::setEditing(bool editing) {
+    invalidateEditBvh();
+    if (editing) {
+        bakedPlayer_.writeBack();
+        bakedPlayer_.clear();
+    } else {
+        rebakePlayer();
+    }
+}
+
+void Game::rebakePlayer() {
+    // Positions of parts that don't hang on a node aren't derived, start from a posed tree
+    updateNodePositions(&player_);
+    updateAppendagePositions(&player_);
+    bakedPlayer_.bake(&player_);
+    logDebug("Baked player: %d parts, %d feet, %d steered hands\n", bakedPlayer_.getPartCount(),
+             (int)bakedPlayer_.getFeet().size(), (int)bakedPlayer_.getSteeredHands().size());
+}
+
+// A recorded session starts from the default scene like its replay does, and leaves
+// the file as it was so the next recording starts there too
+bool Game::usesScene() const {
+    return !headless_ && inputLogPath_.empty() && !scenePath_.empty();
+}
+
+void Game::saveScene() {
+    if (!usesScene()) return;
+    if (bakedPlayer_.isBaked()) bakedPlayer_.writeBack();
+    CreatureFileWriter writer;
+    writer.add(&player_);
+    writer.add(&grabbableBall_);
+    writer.write(scenePath_);
+}
+
+// The design is moved to where the player stands, the editor keeps working on player_
+void Game::loadNextDesign() {
+    if (library_.getCreatureCount() == 0) return;
+    float x = player_.Xpos, y = player_.Ypos;
+    int index = libraryIndex_;
+    libraryIndex_ = (libraryIndex_ + 1) % library_.getCreatureCount();
+    if (!library_.instantiate(index, &player_)) return;
+    player_.isCore = true;
+    player_.Xpos = x;
+    player_.Ypos = y;
+    updateNodePositions(&player_);
+    updateAppendagePositions(&player_);
+    invalidateEditBvh();
+    logDebug("Loaded design %d of %d\n", index, library_.getCreatureCount());
+}
+
+void Game::setInputRecording(const char* path) {
+    inputLogPath_ = path;
+    replaying_ = false;
+}
+
+void Game::setReplay(const char* path) {
+    inputLogPath_ = path;
+    replaying_ = true;
+    headless_ = true;
+}
+
+static void checksumBytes(Uint64& hash, const void* data, size_t size) {
+    const Uint8* bytes = static_cast<const Uint8*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull; // FNV-1a
+    }
+}
+
+static void checksumEntity(Uint64& hash, const Entity* entity) {
+    const float values[] = {entity->Xpos, entity->Ypos, entity->Xvel, entity->Yvel,
+                            entity->offsetX, entity->offsetY, entity->rotation};
+    const int ints[] = {(int)entity->shapetype, entity->width, entity->height, entity->nodeCount,
+                        entity->coreNodeIndex, entity->isHandOrFoot, entity->grabbing};
+    checksumBytes(hash, values, sizeof(values));
+    checksumBytes(hash, ints, sizeof(ints));
+    checksumBytes(hash, entity->nodesRel, sizeof(NodeRel) * entity->nodeCount);
+    for (const auto& app : entity->appendages) {
+        checksumEntity(hash, app.get());
+    }
+}
+
+// Exact simulation state, unlike sceneSignature(): a replay must end with the same bits
+Uint64 Game::stateChecksum() {
+    if (bakedPlayer_.isBaked()) bakedPlayer_.writeBack();
+    Uint64 hash = 14695981039346656037ull;
+    checksumEntity(hash, &player_);
+    checksumEntity(hash, &grabbableBall_);
+    for (const CreatureInstance& creature : crowd_) {
+        checksumBytes(hash, creature.poses.data(), sizeof(CreaturePose) * creature.poses.size());
+        checksumBytes(hash, &creature.yvel, sizeof(creature.yvel));
+    }
+    return hash;
+}
+
+void Game::updateRefreshRate() {
+    if (!window_) return;
+    const SDL_DisplayMode* mode = SDL_GetCurrentDisplayMode(SDL_GetDisplayForWindow(window_));
+    pacer_.setRefreshRate(mode ? mode->refresh_rate : 0.0f);
+    // Leave the same headroom as the 14 ms default leaves at 60 Hz
+    dynamicResolution_.setTargetFrameTime(1000.0f / pacer_.getRefreshRate() * 0.84f);
+    logDebug("Frame pacing at %.2f Hz\n", pacer_.getRefreshRate());
+}
+
+SDL_Surface* Game::readFrame() {
+    SDL_Surface* frame = SDL_RenderReadPixels(sdl_renderer_, nullptr);
+    if (!frame) {
+        printf("SDL_RenderReadPixels Error: %s\n", SDL_GetError());
+        return nullptr;
+    }
+    if (frame->format != SDL_PIXELFORMAT_ARGB8888) {
+        SDL_Surface* converted = SDL_ConvertSurface(frame, SDL_PIXELFORMAT_ARGB8888);
+        SDL_DestroySurface(frame);
+        frame = converted;
+    }
+    return frame;
+}
+
+void Game::onWindowResized(int w, int h) {
+    camera_.setViewport(w, h);
+    inputManager_.layoutButtons(w, h);
+    if (softRaster_) {
+        int pixelW = w, pixelH = h;
+        SDL_GetRenderOutputSize(sdl_renderer_, &pixelW, &pixelH);
+        softRaster_->resize(pixelW, pixelH);
+    }
+    logDebug("Window resized to %dx%d\n", w, h);
+}
+
+void Game::setRecordOnStart(const char* directory, bool offline) {
+    recordDirectory_ = directory;
+    recordOffline_ = offline;
+    if (offline) {
+        headless_ = true;
+    }
+}
+
+void Game::toggleRecording() {
+    if (recorder_.isRecording()) {
+        recorder_.stop();
+        return;
+    }
+    char directory[64];
+    SDL_snprintf(directory, sizeof(directory), "recording_%llu", (unsigned long long)SDL_GetTicks());
+    int w = SCREEN_WIDTH, h = SCREEN_HEIGHT;
+    renderer_.getOutputSize(&w, &h);
+    recorder_.start(directory, w, h);
+}
+
+void Game::setSpriteCacheEnabled(bool enabled) {
+    if (enabled && softRaster_) {
+        logDebug("Sprite cache needs textures, not available with the software rasterizer\n");
+        return;
     }
+    spriteCacheEnabled_ = enabled;
+    if (!enabled) {
+        spriteCache_.release(&player_);
+    }
+    logDebug("Sprite cache %s\n", enabled ? "enabled" : "disabled");
 }
 
+// Copies what the geometry thread needs out of the simulation. Main thread only:
+// it bakes the sprite cache, which draws into the atlas.
+void Game::captureFrame(RenderSnapshot& snapshot) {
+    // Baking switches render targets, so do it before drawing to the window
+    bool playing = bakedPlayer_.isBaked();
+    if (playing && spriteCacheEnabled_ && spriteCache_.needsBake(&player_)) {
+        bakedPlayer_.writeBack(); // The sprite is drawn from the tree
+    }
+    bool useSprite = spriteCacheEnabled_ && !inputManager_.getInventoryOpen() && spriteCache_.bake(&player_);
+
+    // Frames where the pointer moved are timed from the pointer sample to present
+    Uint64 pointerEvent = inputManager_.getMouseTimestamp();
+    bool pointerMoved = pointerEvent != lastPointerEvent_;
+    lastPointerEvent_ = pointerEvent;
+    snapshot.pointerEventTime = pointerMoved ? pointerEvent : 0;
+    snapshot.pointerSampleTime = snapshot.pointerEventTime;
+    if (lateLatch_ && window_ && playing) {
+        // Picks up motion that arrived after handleEvents, the events stay queued
+        SDL_PumpEvents();
+        float mouseX = 0.0f, mouseY = 0.0f;
+        SDL_GetMouseState(&mouseX, &mouseY);
+        SDL_FPoint target = camera_.screenToWorld(mouseX, mouseY);
+        latchHands(target.x, target.y);
+        if (pointerMoved) {
+            snapshot.pointerSampleTime = SDL_GetTicksNS();
+        }
+    }
+
+    snapshot.view = camera_.getViewTransform();
+    // Creatures whose bounds are off screen are skipped entirely. The extra views
+    // share the geometry, so creatures and parts are culled against all of them together.
+    SDL_FRect view = camera_.getViewRect();
+    int windowW = camera_.getViewportWidth();
+    int windowH = camera_.getViewportHeight();
+    if (minimapEnabled_) {
+        // Whole world in a strip at the top
+        int w = windowW / 3;
+        int h = w * WORLD_HEIGHT / WORLD_WIDTH;
+        float scale = (float)w / WORLD_WIDTH;
+        snapshot.extraViews.push_back({{(windowW - w) / 2, 10, w, h}, {scale, 0.0f, 0.0f}});
+        SDL_FRect world = {0.0f, 0.0f, (float)WORLD_WIDTH, (float)WORLD_HEIGHT};
+        SDL_GetRectUnionFloat(&view, &world, &view);
+    }
+    if (inputManager_.getInventoryOpen()) {
+        // Close-up of the creature being edited, bottom right
+        int size = windowW / 4;
+        Camera closeUp(size, size);
+        closeUp.setCenter(player_.Xpos, player_.Ypos);
+        closeUp.setZoom(camera_.getZoom() * CLOSE_UP_ZOOM);
+        snapshot.extraViews.push_back({{windowW - size - 10, windowH - size - 10, size, size}, closeUp.getViewTransform()});
+        SDL_FRect closeUpRect = closeUp.getViewRect();
+        SDL_GetRectUnionFloat(&view, &closeUpRect, &view);
+    }
+    bool showNodes = camera_.getZoom() >= Camera::NODE_MARKER_MIN_ZOOM;
+    // Behind the player. Instances of a blueprint are adjacent in crowd_, so their
+    // items are too and the draw list submits each group in place with one call.
+    for (const CreatureInstance& creature : crowd_) {
+        const CreaturePose* poses = creature.poses.data();
+        if (rectsOverlap(view, creature.blueprint->getBounds(poses))) {
+            captureBlueprintGeometry(*creature.blueprint, poses, snapshot, showNodes, &view, false);
+        }
+    }
+    if (playing && rectsOverlap(view, bakedPlayer_.getBounds())) {
+        if (useSprite) {
+            spriteCache_.collectSprite(&player_, snapshot.sprites);
+        }
+        captureBlueprintGeometry(bakedPlayer_.getBlueprint(), bakedPlayer_.getPoses(), snapshot, showNodes, &view, useSprite);
+    } else if (!playing && rectsOverlap(view, getEntityBounds(&player_))) {
+        if (useSprite) {
+            spriteCache_.collectSprite(&player_, snapshot.sprites);
+            captureDynamicGeometry(&player_, snapshot, showNodes, &view);
+        } else {
+            captureAllGeometry(&player_, snapshot, showNodes, &view);
+        }
+    }
+    if (rectsOverlap(view, getEntityBounds(&grabbableBall_))) {
+        snapshot.depth = 1; // in front of the player
+        captureAllGeometry(&grabbableBall_, snapshot, false, &view);
+    }
+
+    float groundLeft = std::max(0.0f, view.x);
+    float groundRight = std::min((float)WORLD_WIDTH, view.x + view.w);
+    snapshot.groundFrom = {groundLeft, WORLD_HEIGHT - 0.5f};
+    snapshot.groundTo = {groundRight, WORLD_HEIGHT - 0.5f};
+    snapshot.groundThickness = 1.0f / camera_.getZoom();
+    restoreLatchedHands();
+}
+
+void Game::recordPointerLatency(const RenderSnapshot& snapshot) {
+    Uint64 now = SDL_GetTicksNS();
+    float sampleMs = (float)(now - snapshot.pointerSampleTime) / SDL_NS_PER_MS;
+    float eventMs = (float)(now - snapshot.pointerEventTime) / SDL_NS_PER_MS;
+    latency_.sampleSumMs += sampleMs;
+    latency_.eventSumMs += eventMs;
+    latency_.worstMs = std::max(latency_.worstMs, sampleMs);
+    if (++latency_.samples % 120 == 0) {
+        logDebug("Pointer to present: %.2f ms average (%.2f ms from the handled event), %.2f ms worst\n",
+                 latency_.sampleSumMs / latency_.samples, latency_.eventSumMs / latency_.samples, latency_.worstMs);
+    }
+}
+
+// Serial path (headless, golden tests): capture, build and submit in one go
 void Game::render() {
+    serialSlot_.snapshot.clear();
+    captureFrame(serialSlot_.snapshot);
+    buildSnapshotGeometry(serialSlot_.snapshot, serialSlot_.world, serialSlot_.worldRanges, serialSlot_.debug,
+                          serialSlot_.shapes);
+    submitFrame(serialSlot_);
+}
+
+// Captures this frame and submits the previous one, which the geometry thread built
+// while we were simulating. Adds a frame of latency.
+void Game::renderPipelined() {
+    captureFrame(pipeline_->beginSnapshot());
+    pipeline_->publishSnapshot();
+    RenderPipeline::Slot* slot = pipeline_->acquireBuilt();
+    if (slot) {
+        submitFrame(*slot);
+        pipeline_->releaseBuilt(slot);
+    }
+}
+
+void Game::submitFrame(const RenderPipeline::Slot& frame) {
+    Uint64 renderStart = SDL_GetPerformanceCounter();
+    int outputW = 0, outputH = 0;
+    renderer_.getOutputSize(&outputW, &outputH);
+    bool scaled = dynamicResolution_.begin(outputW, outputH);
     renderer_.clear({100, 100, 100, 255});
 
-    renderData_.clear();
-    renderer_.collectAllGeometry(&player_, renderData_, true);
-    renderer_.collectAllGeometry(&grabbableBall_, renderData_, false);
-    renderer_.renderBatchedGeometry(renderData_);
+    drawList_.clear();
+    drawList_.addStatic(DrawLayer::SPRITES, &frame.snapshot.sprites, spriteCache_.getAtlas(), SDL_BLENDMODE_BLEND);
+    for (const SnapshotRange& item : frame.worldRanges) {
+        drawList_.addRange(DrawLayer::WORLD, &frame.world, item.range, item.depth);
+    }
+    drawList_.addStatic(DrawLayer::DEBUG, &frame.debug);
+    if (frame.world.vertexCount() > peakVertexCount_) {
+        peakVertexCount_ = frame.world.vertexCount();
+        logDebug("Scene geometry grew to %d vertices, %d indices in %d chunk(s)\n",
+                 frame.world.vertexCount(), frame.world.indexCount(), frame.world.chunkCount());
+    }
 
+    const SDL_Color frameColor = {255, 255, 255, 255};
+    for (const RenderView& extra : frame.snapshot.extraViews) {
+        SDL_FRect rect = {(float)extra.viewport.x, (float)extra.viewport.y, (float)extra.viewport.w, (float)extra.viewport.h};
+        drawList_.rectOutline(DrawLayer::UI, {rect.x - 1, rect.y - 1, rect.w + 2, rect.h + 2}, frameColor);
+    }
     renderUI();
 
-    renderer_.setDrawColor({255, 255, 255, 255});
-    renderer_.drawLine(0, SCREEN_HEIGHT - 1, SCREEN_WIDTH, SCREEN_HEIGHT - 1);
-
+    // World at reduced resolution when scaled, UI sharp on top of the upscaled image
+    ViewTransform view = scaled ? dynamicResolution_.scaleView(frame.snapshot.view) : frame.snapshot.view;
+    drawList_.flushLayers(renderer_, view, DrawLayer::SPRITES, DrawLayer::UI);
+    if (scaled) {
+        dynamicResolution_.end();
+    }
+    // Same items again for every extra view, only the viewport and transform change
+    for (const RenderView& extra : frame.snapshot.extraViews) {
+        renderer_.setViewport(&extra.viewport);
+        SDL_FPoint corners[4] = {
+            {0.0f, 0.0f}, {(float)extra.viewport.w, 0.0f},
+            {(float)extra.viewport.w, (float)extra.viewport.h}, {0.0f, (float)extra.viewport.h}
+        };
+        viewBackground_.clear();
+        emitQuad(viewBackground_, corners, {0.25f, 0.25f, 0.25f, 1.0f});
+        renderer_.renderBatchedGeometry(viewBackground_);
+        drawList_.flushLayers(renderer_, extra.view, DrawLayer::SPRITES, DrawLayer::UI);
+    }
+    if (!frame.snapshot.extraViews.empty()) {
+        renderer_.setViewport(nullptr);
+    }
+    drawList_.flushLayers(renderer_, view, DrawLayer::UI, DrawLayer::COUNT);
+    // Flush first so the measured time is the drawing itself, not the vsync wait in present
+    renderer_.flush();
+    float renderMs = (SDL_GetPerformanceCounter() - renderStart) * 1000.0f / SDL_GetPerformanceFrequency();
+    float oldScale = dynamicResolution_.getScale();
+    dynamicResolution_.reportFrameTime(renderMs);
+    if (dynamicResolution_.getScale() != oldScale) {
+        logDebug("Render scale %.2f -> %.2f (average %.2f ms)\n", oldScale, dynamicResolution_.getScale(),
+                 dynamicResolution_.getAverageFrameTime());
+    }
+    if (recorder_.isRecording()) {
+        // The back buffer is only valid until present
+        if (softRaster_) {
+            softRaster_->finish();
+            recorder_.capture(softRaster_->getPixels(), SDL_PIXELFORMAT_ARGB8888,
+                              softRaster_->getWidth(), softRaster_->getHeight(), softRaster_->getPitch());
+        } else {
+            recorder_.capture(renderer_);
+        }
+    }
     renderer_.present();
-}
\ No newline at end of file
+    // Present returns when the frame is queued (after the vsync wait), the display's own
+    // scanout latency comes on top of this
+    if (frame.snapshot.pointerSampleTime) {
+        recordPointerLatency(frame.snapshot);
+    }
+}
@@ -2,61 +2,222 @@
 #define GAME_H
 #include <SDL3/SDL.h>
 #include <vector>
+#include <memory>
 #include "entity.h"
 #include "InputManager.h"
 #include "Renderer.h"
+#include "spritecache.h"
+#include "drawlist.h"
+#include "camera.h"
+#include "softraster.h"
+#include "resolution.h"
+#include "renderpipeline.h"
+#include "recorder.h"
+#include "pacer.h"
+#include "inputlog.h"
+#include "creaturefile.h"
+#include "bakedcreature.h"
+#include "creaturebvh.h"
+#include "shapebatch.h"
 
 class Game {
 public:
     Game();
     ~Game();
+    // Call before init(): draw with the CPU rasterizer instead of SDL_RenderGeometry
+    void setSoftRaster(bool enabled) { softRasterRequested_ = enabled; }
+    // Call before init(): no window, render into an offscreen surface with SDL's software renderer
+    void setHeadless(bool headless) { headless_ = headless; }
+    // run() returns after this many frames and prints frame times, 0 = run until quit
+    void setFrameLimit(int frames) { frameLimit_ = frames; }
+    // Call before init(): build geometry on a second thread, one frame behind the simulation
+    void setPipelined(bool pipelined) { pipelined_ = pipelined; }
+    // Re-sample the pointer right before capturing a frame and pose the hands for it
+    void setLateLatch(bool enabled) { lateLatch_ = enabled; }
+    // Call before init(): write the consumed input to path, or replay it from there
+    // headless (run() returns at the end of the log and prints a state checksum)
+    void setInputRecording(const char* path);
+    void setReplay(const char* path);
+    Uint32 getSimStep() const { return simStep_; }
+    Uint64 stateChecksum();
+    // Opening the editor writes the baked player back into its tree and drops the
+    // baked form, closing it bakes again. Gameplay only runs on the baked form.
+    void setEditing(bool editing);
+    // After editing the tree while playing (generated designs)
+    void rebakePlayer();
+    // Call before init(): start recording to directory right away. Offline recording
+    // renders headless as fast as possible and waits for the encoder instead of dropping frames.
+    void setRecordOnStart(const char* directory, bool offline);
+    // Call before init(): the scene (player and ball) is loaded from path in init()
+    // and saved there when the window is closed. Empty disables it. Headless runs and
+    // --record-input sessions never touch it, their replay starts from the default scene.
+    void setScenePath(const char* path) { scenePath_ = path; }
+    void saveScene();
+    // Call before init(): map a creature library, L in the editor swaps in its next design
+    void setLibrary(const char* path) { libraryPath_ = path; }
+    void loadNextDesign();
+    // Adds count creatures sharing the player's current design, spread out to its right.
+    // Call after init() or while playing.
+    void spawnCrowd(int count);
+    void toggleRecording();
     bool init();
     void run();
     void logDebug(const char* format, ...) const;
 
     Entity* getPlayer() { return &player_; }
     InputManager& getInputManager() { return inputManager_; }
+    bool isSpriteCacheEnabled() const { return spriteCacheEnabled_; }
+    void setSpriteCacheEnabled(bool enabled);
+    Camera& getCamera() { return camera_; }
+    bool getCameraFollow() const { return cameraFollow_; }
+    void setCameraFollow(bool follow) { cameraFollow_ = follow; }
+    bool isMinimapEnabled() const { return minimapEnabled_; }
+    void setMinimapEnabled(bool enabled) { minimapEnabled_ = enabled; }
+    void onWindowResized(int w, int h);
+    // Reads the refresh rate of the display the window is on, for the frame pacer
+    void updateRefreshRate();
+    FramePacer& getFramePacer() { return pacer_; }
+    Renderer& getRenderer() { return renderer_; }
+    DynamicResolution& getDynamicResolution() { return dynamicResolution_; }
+    void renderFrame() { render(); }
+    // Copy of the last rendered frame as ARGB8888, caller destroys it. Null on failure.
+    SDL_Surface* readFrame();
 
     bool findParentNodePosition(Entity* appendage, float& nodeX, float& nodeY);
     float angleToPoint(float x1, float y1, float x2, float y2) const;
-    bool addAppendageToEntity(Entity* entity, float mouseX, float mouseY, Shape shape, int& nodeIndex, Entity*& parentEntity, bool isHandOrFoot = false);
+    // Editor edits and picking on player_, the queries go through editBvh_
+    bool attachAppendage(Entity* entity, int nodeIndex, Shape shape, bool isHandOrFoot);
+    bool addAppendageAt(float mouseX, float mouseY, Shape shape, int& nodeIndex, Entity*& parentEntity, bool isHandOrFoot = false);
+    bool removeNodeAt(float x, float y);
+    Entity* pickAppendage(float x, float y);
+    // After adding or removing parts or nodes, or resizing a part
+    void invalidateEditBvh() { editBvh_.clear(); }
+    // After moving subtree (a part of player_)
+    void refitEditBvh(const Entity* subtree) { editBvh_.refit(subtree); }
 
     static constexpr int SCREEN_WIDTH = 700;
     static constexpr int SCREEN_HEIGHT = 700;
+    static constexpr int WORLD_WIDTH = 6000;  // World space, independent of the window size
+    static constexpr int WORLD_HEIGHT = 1500; // Ground is at WORLD_HEIGHT
     static constexpr int MAX_APPENDAGES = 20;
-    static constexpr Uint32 FRAME_DELAY = 1000 / 60;
+    static constexpr float NODE_PICK_RADIUS = 10.0f; // Clicks this close to a node hit it
+    // The simulation runs in fixed steps, independent of the display's refresh rate
+    static constexpr int SIM_HZ = 60;
+    static constexpr Uint64 SIM_STEP_NS = SDL_NS_PER_SECOND / SIM_HZ;
+    static constexpr int MAX_SIM_STEPS = 4; // Per frame, after a stall the simulation slows down instead
+    static constexpr float BACKGROUND_HZ = 20.0f;  // Frame rate while minimized or unfocused
+    static constexpr int IDLE_AFTER_FRAMES = RenderPipeline::MAX_IN_FLIGHT + 1; // Unchanged frames before idling, the pipeline has shown the last change by then
+    static constexpr Sint32 IDLE_TIMEOUT_MS = 250;
     static constexpr float MOVE_SPEED = 5.0f;
     static constexpr float GRAVITY = 0.3f;
     static constexpr float STEP_INTERVAL = 500.0f;
+    static constexpr float CLOSE_UP_ZOOM = 2.5f; // Editor close-up view, relative to the main camera
 
 private:
     SDL_Window* window_;
+    SDL_Surface* offscreen_; // Render target in headless mode, instead of window_
     SDL_Renderer* sdl_renderer_;
     Renderer renderer_;
     InputManager inputManager_;
     Entity player_;
+    BakedCreature bakedPlayer_; // Runtime form of player_ while the editor is closed
+    CreatureBVH editBvh_;       // player_'s parts while editing, built on the first query
+    // Instances of the same blueprint are kept next to each other, so their geometry
+    // ends up in one draw call
+    std::vector<CreatureInstance> crowd_;
     bool debug_;
     Uint32 lastStepTime_;
     int currentStepFoot_;
     float walkCycle_;
-    Uint32 lastFrameTime_;
-    RenderData renderData_;
+    FramePacer pacer_;
+    Uint64 simAccumulator_; // Frame time not simulated yet
+    Uint64 sceneSignature_;
+    int quietFrames_;       // Frames without input or visible change
+    bool lateLatch_;
+    Uint32 simStep_;        // Simulation steps so far, the input log's clock
+    InputLog inputLog_;
+    std::string inputLogPath_;
+    bool replaying_;
+    Uint64 lastPointerEvent_;
+    // Simulated hand pose, put back after a late latched capture
+    struct LatchedHand {
+        int slot; // steered hand
+        CreaturePose pose;
+        float grabbedX, grabbedY, grabbedXvel, grabbedYvel;
+    };
+    std::vector<LatchedHand> latchedHands_;
+    // updateHands: each steered hand's reach this step, and the points of the hands
+    // that start grabbing, queried together
+    struct HandStep {
+        bool attached;
+        SDL_FPoint node;
+        float dx, dy, dist;
+    };
+    std::vector<HandStep> handSteps_;
+    std::vector<int> grabSlots_;
+    std::vector<float> grabX_, grabY_;
+    std::vector<Entity*> grabFound_;
+    std::vector<int> grabHits_;
+    struct PointerLatency {
+        double sampleSumMs = 0.0; // from the pointer sample the hands used
+        double eventSumMs = 0.0;  // from the event handleEvents saw
+        float worstMs = 0.0f;
+        int samples = 0;
+    } latency_;
+    DrawList drawList_;
+    RenderData uiStaticData_; // Button quads, only rebuilt when the layout changes
+    int uiStaticVersion_;
+    Camera camera_;
+    bool cameraFollow_;
+    bool minimapEnabled_;
+    RenderData viewBackground_; // Quad behind the extra views
+    int peakVertexCount_;
+    SpriteCache spriteCache_;
+    bool spriteCacheEnabled_;
+    bool softRasterRequested_;
+    bool headless_;
+    DynamicResolution dynamicResolution_;
+    int frameLimit_;
+    bool pipelined_;
+    std::unique_ptr<RenderPipeline> pipeline_;
+    FrameRecorder recorder_;
+    std::string recordDirectory_; // recording starts in init() when set
+    bool recordOffline_;
+    std::string scenePath_;
+    std::string libraryPath_;
+    CreatureLibrary library_;
+    int libraryIndex_;
+    RenderPipeline::Slot serialSlot_;
+    std::unique_ptr<SoftRasterizer> softRaster_;
     std::vector<Entity*> grabbableEntities_;
+    ShapeBatch grabBatch_; // grabbableEntities_ for getGrabbablesAt
     Entity grabbableBall_; 
 
 
     Entity* findParent(Entity* root, Entity* target);
 
-    Entity* getGrabbableAt(float x, float y, float tolerance);
+    // found[i] = the grabbable within tolerance of point i, null if none
+    void getGrabbablesAt(const float* x, const float* y, int count, float tolerance, Entity** found);
+    CreatureBVH& getEditBvh();
     float distanceSquared(float x1, float y1, float x2, float y2) const;
     void update();
+    void updateCrowd();
+    Uint64 sceneSignature() const;
+    bool isIdle() const;
+    bool usesScene() const;
+    bool replayStep();
+    void printRunStats(int frames, Uint64 workTicks, Uint64 worstTicks);
     void render();
+    void renderPipelined();
+    void captureFrame(RenderSnapshot& snapshot);
+    void submitFrame(const RenderPipeline::Slot& frame);
     void renderUI();
-    void updateWalkingAnimation(Entity* entity);
-    std::vector<Entity*> getFeet(Entity* entity);
-    float getLowestEntityY(Entity* entity);
-    void getEntityMinMaxX(Entity* entity, float& minX, float& maxX);
-    void updateHands(Entity* entity); 
+    void updateWalkingAnimation();
+    void updateHands();
+    void solveHandPose(CreaturePose& pose, const CreatureHand& hand, float nodeX, float nodeY, float dx, float dy, float dist);
+    void latchHands(float targetX, float targetY);
+    void restoreLatchedHands();
+    void recordPointerLatency(const RenderSnapshot& snapshot);
 };
 
 #endif // GAME_H
\ No newline at end of file
@@ -0,0 +1,152 @@
+#include "goldentest.h"
+#include "game.h"
+#include "creaturefile.h"
+#include <cstdio>
+#include <string>
+
+// Same seed, same creature: torso shape and color, then appendages and hands/feet
+// on random nodes (also nodes of earlier appendages)
+static void buildDesign(Game& game, int index) {
+    Uint64 state = 0x9E3779B97F4A7C15ull * (index + 1);
+    Entity* player = game.getPlayer();
+    float x = player->Xpos;
+    float y = player->Ypos;
+    player->appendages.clear();
+    Shape torso = (Shape)SDL_rand_r(&state, 3);
+    SDL_Color color = {(Uint8)SDL_rand_r(&state, 256), (Uint8)SDL_rand_r(&state, 256), (Uint8)SDL_rand_r(&state, 256), 255};
+    initEntity(player, &game.getRenderer(), x, y, 50, 50, torso, color, 50, false, true);
+    player->isCore = true;
+
+    int count = 1 + SDL_rand_r(&state, 6);
+    for (int i = 0; i < count; ++i) {
+        // Pick a node anywhere in the tree by walking down a random path
+        Entity* target = player;
+        while (!target->appendages.empty() && SDL_rand_r(&state, 2) == 0) {
+            target = target->appendages[SDL_rand_r(&state, (Sint32)target->appendages.size())].get();
+        }
+        if (target->nodeCount == 0) continue;
+        int node = SDL_rand_r(&state, target->nodeCount);
+        Shape shape = (Shape)SDL_rand_r(&state, 3);
+        bool isHandOrFoot = SDL_rand_r(&state, 4) == 0;
+        game.attachAppendage(target, node, shape, isHandOrFoot);
+    }
+    updateAppendagePositions(player);
+    game.rebakePlayer();
+    game.getCamera().setCenter(x, y);
+}
+
+// Number of pixels that differ, -1 if the sizes don't match
+static int comparePixels(SDL_Surface* a, SDL_Surface* b) {
+    if (a->w != b->w || a->h != b->h) return -1;
+    int different = 0;
+    for (int y = 0; y < a->h; ++y) {
+        const Uint32* rowA = (const Uint32*)((const Uint8*)a->pixels + y * a->pitch);
+        const Uint32* rowB = (const Uint32*)((const Uint8*)b->pixels + y * b->pitch);
+        for (int x = 0; x < a->w; ++x) {
+            if (rowA[x] != rowB[x]) ++different;
+        }
+    }
+    return different;
+}
+
+int runGoldenTests(const char* dir, int designs, bool update) {
+    Game game;
+    game.setHeadless(true);
+    if (!game.init()) {
+        return 1;
+    }
+    game.setCameraFollow(false);
+
+    int failed = 0;
+    Uint64 renderTicks = 0;
+    Uint64 readTicks = 0;
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < designs; ++i) {
+        buildDesign(game, i);
+
+        Uint64 t0 = SDL_GetPerformanceCounter();
+        game.renderFrame();
+        Uint64 t1 = SDL_GetPerformanceCounter();
+        SDL_Surface* frame = game.readFrame();
+        readTicks += SDL_GetPerformanceCounter() - t1;
+        renderTicks += t1 - t0;
+        if (!frame) {
+            ++failed;
+            continue;
+        }
+
+        char name[32];
+        SDL_snprintf(name, sizeof(name), "design_%04d", i);
+        std::string goldenPath = std::string(dir) + "/" + name + ".bmp";
+        if (update) {
+            if (!SDL_SaveBMP(frame, goldenPath.c_str())) {
+                printf("%s: failed to write: %s\n", goldenPath.c_str(), SDL_GetError());
+                ++failed;
+            }
+            SDL_DestroySurface(frame);
+            continue;
+        }
+
+        SDL_Surface* loaded = SDL_LoadBMP(goldenPath.c_str());
+        if (!loaded) {
+            printf("%s: missing golden image (run with --update-golden)\n", name);
+            ++failed;
+            SDL_DestroySurface(frame);
+            continue;
+        }
+        SDL_Surface* golden = SDL_ConvertSurface(loaded, SDL_PIXELFORMAT_ARGB8888);
+        SDL_DestroySurface(loaded);
+        int different = golden ? comparePixels(frame, golden) : -1;
+        if (different != 0) {
+            std::string actualPath = std::string(dir) + "/" + name + ".actual.bmp";
+            SDL_SaveBMP(frame, actualPath.c_str());
+            if (different < 0) {
+                printf("%s: FAILED, size differs from golden image\n", name);
+            } else {
+                printf("%s: FAILED, %d pixels differ, see %s\n", name, different, actualPath.c_str());
+            }
+            ++failed;
+        }
+        SDL_DestroySurface(golden);
+        SDL_DestroySurface(frame);
+    }
+
+    double toMs = 1000.0 / SDL_GetPerformanceFrequency();
+    double totalMs = (SDL_GetPerformanceCounter() - start) * toMs;
+    printf("%d designs %s in %.1f ms (%.0f designs/minute)\n",
+           designs, update ? "written" : "compared", totalMs, designs * 60000.0 / totalMs);
+    if (designs > 0) {
+        printf("render %.3f ms/frame, readback %.3f ms/frame\n", renderTicks * toMs / designs, readTicks * toMs / designs);
+    }
+    if (!update) {
+        printf("%d passed, %d failed\n", designs - failed, failed);
+    }
+    return failed;
+}
+
+int writeDesignLibrary(const char* path, int designs) {
+    Game game;
+    game.setHeadless(true);
+    if (!game.init()) {
+        return 1;
+    }
+    CreatureFileWriter writer;
+    for (int i = 0; i < designs; ++i) {
+        buildDesign(game, i);
+        writer.add(game.getPlayer());
+    }
+    if (!writer.write(path)) {
+        return 1;
+    }
+
+    // What startup pays for the library
+    Uint64 start = SDL_GetPerformanceCounter();
+    CreatureLibrary library;
+    bool opened = library.open(path);
+    double openMs = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    if (!opened) {
+        return 1;
+    }
+    printf("%d designs written to %s, mapped in %.3f ms\n", library.getCreatureCount(), path, openMs);
+    return 0;
+}
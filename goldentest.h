@@ -0,0 +1,11 @@
+#ifndef GOLDEN_TEST_H
+#define GOLDEN_TEST_H
+
+// Renders generated creature designs headless and compares every frame pixel by
+// pixel with dir/design_NNNN.bmp. With update set the images are (re)written
+// instead. Prints timings, returns the number of failed designs.
+int runGoldenTests(const char* dir, int designs, bool update);
+// Writes the same generated designs as a creature library (creaturefile.h)
+int writeDesignLibrary(const char* path, int designs);
+
+#endif // GOLDEN_TEST_H
@@ -0,0 +1,145 @@
+#include "inputlog.h"
+
+bool InputLog::openWrite(const std::string& path, int windowW, int windowH) {
+    close();
+    file_ = fopen(path.c_str(), "wb");
+    if (!file_) {
+        printf("InputLog: cannot create %s\n", path.c_str());
+        return false;
+    }
+    writing_ = true;
+    windowW_ = windowW;
+    windowH_ = windowH;
+    Uint32 header[4] = {MAGIC, VERSION, (Uint32)windowW, (Uint32)windowH};
+    fwrite(header, sizeof(header), 1, file_);
+    return true;
+}
+
+bool InputLog::openRead(const std::string& path) {
+    close();
+    file_ = fopen(path.c_str(), "rb");
+    if (!file_) {
+        printf("InputLog: cannot open %s\n", path.c_str());
+        return false;
+    }
+    writing_ = false;
+    Uint32 header[4];
+    if (fread(header, sizeof(header), 1, file_) != 1 || header[0] != MAGIC || header[1] != VERSION) {
+        printf("InputLog: %s is not a version %u input log\n", path.c_str(), VERSION);
+        fclose(file_);
+        file_ = nullptr;
+        return false;
+    }
+    windowW_ = (int)header[2];
+    windowH_ = (int)header[3];
+    finished_ = false;
+    havePending_ = false;
+    return true;
+}
+
+void InputLog::close(Uint32 lastStep) {
+    if (!file_) return;
+    if (writing_) {
+        InputLogRecord end = {lastStep, END, 0, 0, 0.0f, 0.0f, 0.0f, 0.0f};
+        fwrite(&end, sizeof(end), 1, file_);
+    }
+    fclose(file_);
+    file_ = nullptr;
+}
+
+void InputLog::write(Uint32 step, const SDL_Event& event) {
+    if (!isWriting()) return;
+    InputLogRecord record = {step, event.type, 0, 0, 0.0f, 0.0f, 0.0f, 0.0f};
+    switch (event.type) {
+        case SDL_EVENT_KEY_DOWN:
+        case SDL_EVENT_KEY_UP:
+            record.code = event.key.key;
+            record.flags = event.key.repeat ? 1 : 0;
+            break;
+        case SDL_EVENT_MOUSE_BUTTON_DOWN:
+        case SDL_EVENT_MOUSE_BUTTON_UP:
+            record.code = event.button.button;
+            record.x = event.button.x;
+            record.y = event.button.y;
+            break;
+        case SDL_EVENT_MOUSE_MOTION:
+            record.code = event.motion.state;
+            record.x = event.motion.x;
+            record.y = event.motion.y;
+            record.dx = event.motion.xrel;
+            record.dy = event.motion.yrel;
+            break;
+        case SDL_EVENT_MOUSE_WHEEL:
+            record.x = event.wheel.mouse_x;
+            record.y = event.wheel.mouse_y;
+            record.dy = event.wheel.y;
+            break;
+        case SDL_EVENT_WINDOW_RESIZED:
+            record.x = (float)event.window.data1;
+            record.y = (float)event.window.data2;
+            break;
+        case SDL_EVENT_QUIT:
+            break;
+        default:
+            return;
+    }
+    fwrite(&record, sizeof(record), 1, file_);
+}
+
+bool InputLog::readNext() {
+    if (fread(&next_, sizeof(next_), 1, file_) != 1) {
+        // Truncated log (the game was killed), ends after the last complete record
+        next_ = {0, END, 0, 0, 0.0f, 0.0f, 0.0f, 0.0f};
+        return false;
+    }
+    return true;
+}
+
+bool InputLog::read(Uint32 step, SDL_Event& event) {
+    if (!isReading() || finished_) return false;
+    if (!havePending_) {
+        readNext();
+        havePending_ = true;
+    }
+    if (next_.type == END) {
+        finished_ = true;
+        return false;
+    }
+    if (next_.step > step) return false;
+    havePending_ = false;
+
+    SDL_zero(event);
+    event.type = next_.type;
+    switch (next_.type) {
+        case SDL_EVENT_KEY_DOWN:
+        case SDL_EVENT_KEY_UP:
+            event.key.key = next_.code;
+            event.key.repeat = next_.flags & 1;
+            event.key.down = next_.type == SDL_EVENT_KEY_DOWN;
+            break;
+        case SDL_EVENT_MOUSE_BUTTON_DOWN:
+        case SDL_EVENT_MOUSE_BUTTON_UP:
+            event.button.button = (Uint8)next_.code;
+            event.button.x = next_.x;
+            event.button.y = next_.y;
+            event.button.down = next_.type == SDL_EVENT_MOUSE_BUTTON_DOWN;
+            break;
+        case SDL_EVENT_MOUSE_MOTION:
+            event.motion.state = next_.code;
+            event.motion.x = next_.x;
+            event.motion.y = next_.y;
+            event.motion.xrel = next_.dx;
+            event.motion.yrel = next_.dy;
+            break;
+        case SDL_EVENT_MOUSE_WHEEL:
+            event.wheel.mouse_x = next_.x;
+            event.wheel.mouse_y = next_.y;
+            event.wheel.y = next_.dy;
+            break;
+        case SDL_EVENT_WINDOW_RESIZED:
+            event.window.data1 = (Sint32)next_.x;
+            event.window.data2 = (Sint32)next_.y;
+            break;
+    }
+    return true;
+}
@@ -0,0 +1,61 @@
+#ifndef INPUT_LOG_H
+#define INPUT_LOG_H
+
+#include <SDL3/SDL.h>
+#include <cstdio>
+#include <string>
+
+// Binary log of the input events the simulation consumed, tagged with the index of
+// the simulation step that consumed them. Replaying a log into a headless game gives
+// the same state bit for bit. Only the fields InputManager reads are kept:
+//   header: "SDLI" magic, version, window size at the start
+//   records: InputLogRecord, an END record with the final step closes the log
+struct InputLogRecord {
+    Uint32 step;
+    Uint32 type;    // SDL_EventType, or InputLog::END
+    Uint32 code;    // key, mouse button or motion button state
+    Uint32 flags;   // 1 = key repeat
+    float x, y;     // mouse position, wheel mouse position, window size
+    float dx, dy;   // motion xrel/yrel, wheel y
+};
+
+class InputLog {
+public:
+    static constexpr Uint32 MAGIC = 0x494C4453; // "SDLI"
+    static constexpr Uint32 VERSION = 1;
+    static constexpr Uint32 END = 0xFFFFFFFF;
+
+    InputLog() = default;
+    ~InputLog() { close(); }
+    InputLog(const InputLog&) = delete;
+    InputLog& operator=(const InputLog&) = delete;
+
+    bool openWrite(const std::string& path, int windowW, int windowH);
+    bool openRead(const std::string& path);
+    // Writes the END record when writing
+    void close(Uint32 lastStep = 0);
+    bool isWriting() const { return file_ && writing_; }
+    bool isReading() const { return file_ && !writing_; }
+    int getWindowWidth() const { return windowW_; }
+    int getWindowHeight() const { return windowH_; }
+
+    // Events InputManager doesn't handle are skipped
+    void write(Uint32 step, const SDL_Event& event);
+    // Next record of the given step. Returns false when the next record belongs to a
+    // later step; finished() is true after END.
+    bool read(Uint32 step, SDL_Event& event);
+    bool finished() const { return finished_; }
+    Uint32 getEndStep() const { return next_.step; }
+
+private:
+    FILE* file_ = nullptr;
+    bool writing_ = false;
+    bool finished_ = false;
+    bool havePending_ = false;
+    InputLogRecord next_ = {};
+    int windowW_ = 0, windowH_ = 0;
+
+    bool readNext();
+};
+
+#endif // INPUT_LOG_H
@@ -0,0 +1,49 @@
+#ifndef INPUT_QUEUE_H
+#define INPUT_QUEUE_H
+
+#include <SDL3/SDL.h>
+#include <atomic>
+
+// Single producer, single consumer ring of SDL events, consumed in timestamp order.
+// Neither side locks or blocks, so events could be gathered on another thread than
+// the one running the simulation. When the ring is full push() drops the event, so
+// producers check full() first and leave the rest where it came from.
+class InputQueue {
+public:
+    static constexpr Uint32 CAPACITY = 1024; // power of two
+
+    // Producer
+    bool push(const SDL_Event& event) {
+        Uint32 head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) == CAPACITY) return false;
+        events_[head & (CAPACITY - 1)] = event;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool full() const {
+        return head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_acquire) == CAPACITY;
+    }
+
+    // Consumer: the oldest event, if it happened at or before until (SDL_GetTicksNS time)
+    bool popUntil(Uint64 until, SDL_Event& event) {
+        Uint32 tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) return false;
+        const SDL_Event& next = events_[tail & (CAPACITY - 1)];
+        if (next.common.timestamp > until) return false;
+        event = next;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return tail_.load(std::memory_order_acquire) == head_.load(std::memory_order_acquire);
+    }
+
+private:
+    SDL_Event events_[CAPACITY];
+    alignas(64) std::atomic<Uint32> head_{0}; // next slot to write, only the producer stores
+    alignas(64) std::atomic<Uint32> tail_{0}; // next slot to read, only the consumer stores
+};
+
+#endif // INPUT_QUEUE_H
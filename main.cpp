@@ -1,14 +1,104 @@
 /*
-g++ -Wall -Wextra -g3 -Ic:/Users/melle/Desktop/sdlvoorjari/project/include -Lc:/Users/melle/Desktop/sdlvoorjari/project/lib -LC:/msys64/mingw64/lib c:/Users/melle/Desktop/sdlvoorjari/main.cpp c:/Users/melle/Desktop/sdlvoorjari/entity.cpp c:/Users/melle/Desktop/sdlvoorjari/game.cpp c:/Users/melle/Desktop/sdlvoorjari/InputManager.cpp c:/Users/melle/Desktop/sdlvoorjari/Renderer.cpp -o c:/Users/melle/Desktop/sdlvoorjari/output/main.exe -lmingw32 -lSDL3
+g++ -Wall -Wextra -g3 -Ic:/Users/melle/Desktop/sdlvoorjari/project/include -Lc:/Users/melle/Desktop/sdlvoorjari/project/lib -LC:/msys64/mingw64/lib c:/Users/melle/Desktop/sdlvoorjari/main.cpp c:/Users/melle/Desktop/sdlvoorjari/entity.cpp c:/Users/melle/Desktop/sdlvoorjari/game.cpp c:/Users/melle/Desktop/sdlvoorjari/InputManager.cpp c:/Users/melle/Desktop/sdlvoorjari/Renderer.cpp c:/Users/melle/Desktop/sdlvoorjari/spritecache.cpp c:/Users/melle/Desktop/sdlvoorjari/drawlist.cpp c:/Users/melle/Desktop/sdlvoorjari/softraster.cpp c:/Users/melle/Desktop/sdlvoorjari/benchmark.cpp c:/Users/melle/Desktop/sdlvoorjari/goldentest.cpp c:/Users/melle/Desktop/sdlvoorjari/resolution.cpp c:/Users/melle/Desktop/sdlvoorjari/renderpipeline.cpp c:/Users/melle/Desktop/sdlvoorjari/recorder.cpp c:/Users/melle/Desktop/sdlvoorjari/pacer.cpp c:/Users/melle/Desktop/sdlvoorjari/inputlog.cpp c:/Users/melle/Desktop/sdlvoorjari/mappedfile.cpp c:/Users/melle/Desktop/sdlvoorjari/creaturefile.cpp c:/Users/melle/Desktop/sdlvoorjari/bakedcreature.cpp c:/Users/melle/Desktop/sdlvoorjari/creaturebvh.cpp c:/Users/melle/Desktop/sdlvoorjari/shapebatch.cpp -o c:/Users/melle/Desktop/sdlvoorjari/output/main.exe -lmingw32 -lSDL3
 */
 
+#include <cstring>
+#include <cstdlib>
 #include "game.h"
+#include "benchmark.h"
+#include "goldentest.h"
+#include "creaturefile.h"
 
-int main() {
+// --soft-raster          draw with the CPU rasterizer
+// --bench-raster [n]     compare SDL's software renderer with the CPU rasterizer and exit
+// --bench-shapes [n]     time and validate the batched point-in-shape kernels with n points and exit
+// --headless             no window, render offscreen
+// --frames n             stop after n frames and print frame times
+// --golden dir           compare generated designs with the golden images in dir and exit
+// --update-golden        with --golden: write the golden images instead
+// --designs n            with --golden or --export-designs: number of designs (default 100)
+// --render-scale s       pin the world render scale (0.5 - 1) instead of adapting it
+// --serial               build geometry on the main thread instead of pipelining it
+// --record dir           record every frame to dir as QOI images (F9 toggles recording while playing)
+// --offline              with --record: render headless as fast as possible, never drop frames
+// --no-late-latch        pose the hands for the pointer position the simulation saw
+// --record-input file    write the input of the session to file
+// --replay file          replay an input log headless, print timings and the final state checksum
+// --scene file           load the scene from file and save it there on quit (default scene.sdlc, "" = off,
+//                        ignored with --record-input)
+// --library file         creature library to cycle through in the editor with L
+// --export-designs file  with --designs: write the generated designs as a creature library and exit
+// --export-text in out   write creature file in as text to out and exit
+// --crowd n              spawn n creatures sharing the player's design (G adds 10 while playing)
+int main(int argc, char* argv[]) {
     Game game;
+    const char* goldenDir = nullptr;
+    bool updateGolden = false;
+    int designs = 100;
+    const char* recordDir = nullptr;
+    bool offline = false;
+    const char* exportDesigns = nullptr;
+    int crowd = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--bench-raster") == 0) {
+            int frames = (i + 1 < argc) ? atoi(argv[i + 1]) : 0;
+            return runRasterBenchmark(frames > 0 ? frames : 100);
+        } else if (strcmp(argv[i], "--bench-shapes") == 0) {
+            int points = (i + 1 < argc) ? atoi(argv[i + 1]) : 0;
+            return runShapeBenchmark(points > 0 ? points : 100000);
+        } else if (strcmp(argv[i], "--soft-raster") == 0) {
+            game.setSoftRaster(true);
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            game.setHeadless(true);
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            game.setFrameLimit(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc) {
+            goldenDir = argv[++i];
+        } else if (strcmp(argv[i], "--update-golden") == 0) {
+            updateGolden = true;
+        } else if (strcmp(argv[i], "--designs") == 0 && i + 1 < argc) {
+            designs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--render-scale") == 0 && i + 1 < argc) {
+            game.getDynamicResolution().pinScale((float)atof(argv[++i]));
+        } else if (strcmp(argv[i], "--serial") == 0) {
+            game.setPipelined(false);
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordDir = argv[++i];
+        } else if (strcmp(argv[i], "--offline") == 0) {
+            offline = true;
+        } else if (strcmp(argv[i], "--no-late-latch") == 0) {
+            game.setLateLatch(false);
+        } else if (strcmp(argv[i], "--record-input") == 0 && i + 1 < argc) {
+            game.setInputRecording(argv[++i]);
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            game.setReplay(argv[++i]);
+        } else if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+            game.setScenePath(argv[++i]);
+        } else if (strcmp(argv[i], "--library") == 0 && i + 1 < argc) {
+            game.setLibrary(argv[++i]);
+        } else if (strcmp(argv[i], "--crowd") == 0 && i + 1 < argc) {
+            crowd = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--export-designs") == 0 && i + 1 < argc) {
+            exportDesigns = argv[++i];
+        } else if (strcmp(argv[i], "--export-text") == 0 && i + 2 < argc) {
+            CreatureLibrary library;
+            bool ok = library.open(argv[i + 1]) && library.exportText(argv[i + 2]);
+            return ok ? 0 : 1;
+        }
+    }
+    if (recordDir) {
+        game.setRecordOnStart(recordDir, offline);
+    }
+    if (exportDesigns) {
+        return writeDesignLibrary(exportDesigns, designs);
+    }
+    if (goldenDir) {
+        return runGoldenTests(goldenDir, designs, updateGolden) == 0 ? 0 : 1;
+    }
     if (!game.init()) {
         return 1;
     }
+    game.spawnCrowd(crowd);
     game.run();
     return 0;
-}
\ No newline at end of file
+}
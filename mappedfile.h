@@ -0,0 +1,31 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <SDL3/SDL.h>
+#include <string>
+
+// Read-only view of a whole file through the OS page cache (MapViewOfFile / mmap).
+// Opening costs the same for any file size, pages are read on first access.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return data_ != nullptr; }
+    const Uint8* getData() const { return data_; }
+    size_t getSize() const { return size_; }
+
+private:
+    const Uint8* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void* file_ = nullptr;    // HANDLE
+    void* mapping_ = nullptr; // HANDLE
+#endif
+};
+
+#endif // MAPPED_FILE_H
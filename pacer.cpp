@@ -0,0 +1,59 @@
+#include "pacer.h"
+#include <cmath>
+#include <algorithm>
+
+void FramePacer::setRefreshRate(float hz) {
+    if (hz <= 0.0f) hz = DEFAULT_REFRESH_RATE;
+    periodNs_ = (Uint64)(SDL_NS_PER_SECOND / hz);
+}
+
+void FramePacer::setThrottle(float hz) {
+    throttleNs_ = hz > 0.0f ? (Uint64)(SDL_NS_PER_SECOND / hz) : 0;
+}
+
+void FramePacer::start() {
+    resync();
+    resetStats();
+}
+
+void FramePacer::resync() {
+    lastFrame_ = SDL_GetTicksNS();
+    deadline_ = lastFrame_ + getPeriod();
+}
+
+void FramePacer::resetStats() {
+    lastErrorMs_ = 0.0f;
+    averageErrorMs_ = 0.0f;
+    worstErrorMs_ = 0.0f;
+    missedFrames_ = 0;
+}
+
+Uint64 FramePacer::wait() {
+    Uint64 now = SDL_GetTicksNS();
+    Uint64 period = getPeriod();
+    if (!vsync_ || isThrottled()) {
+        while (now + SPIN_NS < deadline_) {
+            SDL_DelayNS(deadline_ - now - SPIN_NS);
+            now = SDL_GetTicksNS();
+        }
+        while (now < deadline_) {
+            SDL_CPUPauseInstruction();
+            now = SDL_GetTicksNS();
+        }
+    }
+    // Deadlines advance by whole periods so errors don't accumulate. After a missed
+    // frame (or a long stall) start over from now instead of rushing to catch up.
+    deadline_ += period;
+    if (deadline_ <= now) {
+        ++missedFrames_;
+        deadline_ = now + period;
+    }
+
+    Uint64 interval = now - lastFrame_;
+    lastFrame_ = now;
+    lastErrorMs_ = (float)((double)interval - (double)period) / SDL_NS_PER_MS;
+    float error = std::fabs(lastErrorMs_);
+    averageErrorMs_ += (error - averageErrorMs_) * SMOOTHING;
+    worstErrorMs_ = std::max(worstErrorMs_, error);
+    return interval;
+}
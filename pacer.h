@@ -0,0 +1,55 @@
+#ifndef PACER_H
+#define PACER_H
+
+#include <SDL3/SDL.h>
+
+// Paces frames to the display's refresh period with nanosecond timing. Without vsync
+// wait() sleeps until shortly before the deadline and spins the rest, because
+// SDL_DelayNS can overshoot by a scheduler tick. With vsync present() already waits,
+// so wait() only measures. The pacing error is how far each frame interval was
+// from the period.
+class FramePacer {
+public:
+    static constexpr Uint64 SPIN_NS = 2 * SDL_NS_PER_MS; // Spin instead of sleeping for the last part
+    static constexpr float DEFAULT_REFRESH_RATE = 60.0f;
+    static constexpr float SMOOTHING = 0.05f;           // Weight of the newest frame in the average
+
+    void setRefreshRate(float hz);
+    float getRefreshRate() const { return (float)SDL_NS_PER_SECOND / periodNs_; }
+    // Caps the rate below the refresh rate (background windows), 0 turns it off. Throttled
+    // frames are always slept, presenting to a hidden window doesn't have to block.
+    void setThrottle(float hz);
+    bool isThrottled() const { return throttleNs_ > periodNs_; }
+    // Frame period in effect, the refresh period or the throttled one
+    Uint64 getPeriod() const { return isThrottled() ? throttleNs_ : periodNs_; }
+    void setVSync(bool vsync) { vsync_ = vsync; }
+    bool getVSync() const { return vsync_; }
+
+    // Call once before the first frame
+    void start();
+    // End of a frame: waits until the next one is due (unless vsync does that) and
+    // records the pacing error. Returns the time since the previous frame.
+    Uint64 wait();
+    // Starts the deadlines over after the loop blocked elsewhere (idle waits), so the
+    // gap counts as neither a missed frame nor pacing error
+    void resync();
+
+    float getLastErrorMs() const { return lastErrorMs_; }
+    float getAverageErrorMs() const { return averageErrorMs_; }
+    float getWorstErrorMs() const { return worstErrorMs_; }
+    int getMissedFrames() const { return missedFrames_; }
+    void resetStats();
+
+private:
+    Uint64 periodNs_ = (Uint64)(SDL_NS_PER_SECOND / DEFAULT_REFRESH_RATE);
+    Uint64 throttleNs_ = 0;
+    bool vsync_ = false;
+    Uint64 deadline_ = 0;
+    Uint64 lastFrame_ = 0;
+    float lastErrorMs_ = 0.0f;
+    float averageErrorMs_ = 0.0f;
+    float worstErrorMs_ = 0.0f;
+    int missedFrames_ = 0;
+};
+
+#endif // PACER_H
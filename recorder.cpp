@@ -0,0 +1,216 @@
+#include "recorder.h"
+#include <cstdio>
+#include <cstring>
+
+FrameRecorder::~FrameRecorder() {
+    stop();
+}
+
+bool FrameRecorder::start(const std::string& directory, int w, int h, bool blocking) {
+    if (recording_) stop();
+    if (w <= 0 || h <= 0) return false;
+    if (!SDL_CreateDirectory(directory.c_str())) {
+        printf("FrameRecorder: can't create %s: %s\n", directory.c_str(), SDL_GetError());
+        return false;
+    }
+    directory_ = directory;
+    width_ = w;
+    height_ = h;
+    blocking_ = blocking;
+    frameNumber_ = 0;
+    captured_ = 0;
+    dropped_ = 0;
+    written_ = 0;
+    bytesWritten_ = 0;
+    encodeTicks_ = 0;
+
+    // All allocation happens here, capture() only copies
+    for (int i = 0; i < POOL_SIZE; ++i) {
+        buffers_[i].pixels.resize((size_t)w * h);
+        freeList_[i] = i;
+    }
+    freeCount_ = POOL_SIZE;
+    queueHead_ = 0;
+    queueCount_ = 0;
+    // header + 5 bytes per pixel (QOI_OP_RGBA) + end marker
+    encoded_.resize(14 + (size_t)w * h * 5 + 8);
+
+    quit_ = false;
+    recording_ = true;
+    encoder_ = std::thread(&FrameRecorder::encoderLoop, this);
+    printf("Recording %dx%d to %s\n", w, h, directory.c_str());
+    return true;
+}
+
+void FrameRecorder::stop() {
+    if (!recording_) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    cv_.notify_all();
+    encoder_.join();
+    recording_ = false;
+    double encodeMs = written_ > 0 ? encodeTicks_ * 1000.0 / SDL_GetPerformanceFrequency() / written_ : 0.0;
+    printf("Recording stopped: %d frames written, %d dropped, %.1f MB, %.2f ms/frame encoding\n",
+           written_, dropped_, bytesWritten_ / (1024.0 * 1024.0), encodeMs);
+}
+
+// Free buffer index, or -1 (frame dropped)
+int FrameRecorder::acquireBuffer() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (freeCount_ == 0) {
+        if (!blocking_) {
+            ++dropped_;
+            ++frameNumber_; // keep the numbering in step with time
+            return -1;
+        }
+        cv_.wait(lock, [this] { return freeCount_ > 0; });
+    }
+    return freeList_[--freeCount_];
+}
+
+void FrameRecorder::capture(Renderer& renderer) {
+    if (!recording_) return;
+    SDL_Surface* frame = renderer.readPixels();
+    if (!frame) {
+        printf("FrameRecorder: SDL_RenderReadPixels Error: %s\n", SDL_GetError());
+        return;
+    }
+    capture(frame->pixels, frame->format, frame->w, frame->h, frame->pitch);
+    SDL_DestroySurface(frame);
+}
+
+void FrameRecorder::capture(const void* pixels, SDL_PixelFormat format, int w, int h, int pitch) {
+    if (!recording_) return;
+    if (w != width_ || h != height_) {
+        // Window was resized, the pool has the size recording started with
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++dropped_;
+        ++frameNumber_;
+        return;
+    }
+    int index = acquireBuffer();
+    if (index < 0) return;
+    FrameBuffer& buffer = buffers_[index];
+    SDL_ConvertPixels(w, h, format, pixels, pitch, SDL_PIXELFORMAT_ARGB8888, buffer.pixels.data(), w * 4);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        buffer.frame = frameNumber_++;
+        ++captured_;
+        queue_[(queueHead_ + queueCount_) % POOL_SIZE] = index;
+        ++queueCount_;
+    }
+    cv_.notify_all();
+}
+
+void FrameRecorder::encoderLoop() {
+    for (;;) {
+        int index;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return quit_ || queueCount_ > 0; });
+            // Finish the queue before quitting
+            if (queueCount_ == 0) return;
+            index = queue_[queueHead_];
+            queueHead_ = (queueHead_ + 1) % POOL_SIZE;
+            --queueCount_;
+        }
+        FrameBuffer& buffer = buffers_[index];
+        Uint64 start = SDL_GetPerformanceCounter();
+        size_t size = encodeQoi(buffer.pixels.data(), encoded_.data());
+        encodeTicks_ += SDL_GetPerformanceCounter() - start;
+
+        char name[32];
+        SDL_snprintf(name, sizeof(name), "/frame_%06d.qoi", buffer.frame);
+        std::string path = directory_ + name;
+        FILE* file = fopen(path.c_str(), "wb");
+        if (file) {
+            fwrite(encoded_.data(), 1, size, file);
+            fclose(file);
+            bytesWritten_ += size;
+            ++written_;
+        } else {
+            printf("FrameRecorder: can't write %s\n", path.c_str());
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            freeList_[freeCount_++] = index;
+        }
+        cv_.notify_all();
+    }
+}
+
+// QOI, "The Quite OK Image Format" (qoiformat.org), lossless
+size_t FrameRecorder::encodeQoi(const Uint32* pixels, Uint8* out) const {
+    size_t p = 0;
+    auto write32 = [&](Uint32 v) {
+        out[p++] = (Uint8)(v >> 24);
+        out[p++] = (Uint8)(v >> 16);
+        out[p++] = (Uint8)(v >> 8);
+        out[p++] = (Uint8)v;
+    };
+    write32(0x716F6966); // "qoif"
+    write32((Uint32)width_);
+    write32((Uint32)height_);
+    out[p++] = 4; // channels
+    out[p++] = 0; // sRGB with linear alpha
+
+    Uint32 index[64] = {};
+    Uint8 pr = 0, pg = 0, pb = 0, pa = 255;
+    int run = 0;
+    size_t count = (size_t)width_ * height_;
+    for (size_t i = 0; i < count; ++i) {
+        Uint32 px = pixels[i];
+        Uint8 a = (Uint8)(px >> 24), r = (Uint8)(px >> 16), g = (Uint8)(px >> 8), b = (Uint8)px;
+        if (r == pr && g == pg && b == pb && a == pa) {
+            if (++run == 62 || i == count - 1) {
+                out[p++] = (Uint8)(0xC0 | (run - 1)); // QOI_OP_RUN
+                run = 0;
+            }
+            continue;
+        }
+        if (run > 0) {
+            out[p++] = (Uint8)(0xC0 | (run - 1));
+            run = 0;
+        }
+        int hash = (r * 3 + g * 5 + b * 7 + a * 11) % 64;
+        Uint32 packed = ((Uint32)r << 24) | ((Uint32)g << 16) | ((Uint32)b << 8) | a;
+        if (index[hash] == packed) {
+            out[p++] = (Uint8)hash; // QOI_OP_INDEX
+        } else {
+            index[hash] = packed;
+            if (a == pa) {
+                int dr = (Sint8)(r - pr);
+                int dg = (Sint8)(g - pg);
+                int db = (Sint8)(b - pb);
+                int drg = dr - dg;
+                int dbg = db - dg;
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                    out[p++] = (Uint8)(0x40 | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2)); // QOI_OP_DIFF
+                } else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+                    out[p++] = (Uint8)(0x80 | (dg + 32)); // QOI_OP_LUMA
+                    out[p++] = (Uint8)(((drg + 8) << 4) | (dbg + 8));
+                } else {
+                    out[p++] = 0xFE; // QOI_OP_RGB
+                    out[p++] = r;
+                    out[p++] = g;
+                    out[p++] = b;
+                }
+            } else {
+                out[p++] = 0xFF; // QOI_OP_RGBA
+                out[p++] = r;
+                out[p++] = g;
+                out[p++] = b;
+                out[p++] = a;
+            }
+        }
+        pr = r;
+        pg = g;
+        pb = b;
+        pa = a;
+    }
+    static const Uint8 endMarker[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+    memcpy(out + p, endMarker, sizeof(endMarker));
+    return p + sizeof(endMarker);
+}
@@ -0,0 +1,74 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <SDL3/SDL.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include "Renderer.h"
+
+// Records frames as numbered QOI images (frame_000001.qoi, ...) in a directory.
+// The game thread only copies into one of POOL_SIZE preallocated buffers, a
+// background thread encodes and writes them. When the encoder falls behind and no
+// buffer is free the frame is dropped and counted, unless recording is blocking
+// (offline rendering), then the game thread waits instead.
+class FrameRecorder {
+public:
+    static constexpr int POOL_SIZE = 8;
+
+    FrameRecorder() = default;
+    ~FrameRecorder();
+    FrameRecorder(const FrameRecorder&) = delete;
+    FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+    // Allocates the pool and starts the encoder thread. Frames must be w x h.
+    bool start(const std::string& directory, int w, int h, bool blocking = false);
+    // Writes the queued frames, then stops the thread and prints the stats
+    void stop();
+    bool isRecording() const { return recording_; }
+
+    // Reads the current render target back, call before present
+    void capture(Renderer& renderer);
+    // Same, for frames that are already in memory (software rasterizer)
+    void capture(const void* pixels, SDL_PixelFormat format, int w, int h, int pitch);
+
+    int getCapturedCount() const { return captured_; }
+    int getDroppedCount() const { return dropped_; }
+
+private:
+    struct FrameBuffer {
+        std::vector<Uint32> pixels; // ARGB8888
+        int frame;
+    };
+
+    std::string directory_;
+    int width_ = 0, height_ = 0;
+    bool blocking_ = false;
+    bool recording_ = false;
+    int frameNumber_ = 0;
+    int captured_ = 0;
+    int dropped_ = 0;
+    int written_ = 0;
+    size_t bytesWritten_ = 0;
+    Uint64 encodeTicks_ = 0;
+
+    FrameBuffer buffers_[POOL_SIZE];
+    int freeList_[POOL_SIZE];
+    int freeCount_ = 0;
+    int queue_[POOL_SIZE]; // filled buffers, oldest first
+    int queueHead_ = 0;
+    int queueCount_ = 0;
+    bool quit_ = false;
+    std::vector<Uint8> encoded_; // worst case QOI size, reused for every frame
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread encoder_;
+
+    int acquireBuffer();
+    void encoderLoop();
+    size_t encodeQoi(const Uint32* pixels, Uint8* out) const;
+};
+
+#endif // RECORDER_H
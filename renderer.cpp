@@ -1,4 +1,6 @@
 #include "Renderer.h"
+#include "softraster.h"
+#include "shapetraits.h"
 #include <cmath>
 #include <algorithm>
 
@@ -6,262 +8,314 @@
 #define M_PI 3.14159265358979323846
 #endif
 
-void Renderer::collectLineGeometry(float x1, float y1, float x2, float y2, SDL_Color color, RenderData& data, float thickness) {
+// Precomputed unit circles so circle emission needs no trig per vertex
+struct UnitCircleTables {
+    std::vector<SDL_FPoint> tables[MAX_CIRCLE_SIDES + 1];
+    UnitCircleTables() {
+        for (int sides = 3; sides <= MAX_CIRCLE_SIDES; ++sides) {
+            for (int i = 0; i < sides; ++i) {
+                float angle = 2.0f * M_PI * i / sides;
+                tables[sides].push_back({std::cos(angle), std::sin(angle)});
+            }
+        }
+    }
+};
+
+static const SDL_FPoint* unitCircle(int sides) {
+    static const UnitCircleTables circles;
+    return circles.tables[sides].data();
+}
+
+void emitQuad(RenderData& data, const SDL_FPoint corners[4], SDL_FColor color) {
+    Uint16 baseIndex = data.beginShape(4);
+    for (int i = 0; i < 4; ++i) {
+        data.addVertex(corners[i].x, corners[i].y, color);
+    }
+    data.indices.insert(data.indices.end(), {baseIndex, (Uint16)(baseIndex + 1), (Uint16)(baseIndex + 2),
+                                             (Uint16)(baseIndex + 2), (Uint16)(baseIndex + 3), baseIndex});
+}
+
+void emitTriangle(RenderData& data, SDL_FPoint p1, SDL_FPoint p2, SDL_FPoint p3, SDL_FColor color) {
+    Uint16 baseIndex = data.beginShape(3);
+    data.addVertex(p1.x, p1.y, color);
+    data.addVertex(p2.x, p2.y, color);
+    data.addVertex(p3.x, p3.y, color);
+    data.indices.insert(data.indices.end(), {baseIndex, (Uint16)(baseIndex + 1), (Uint16)(baseIndex + 2)});
+}
+
+// A fan around the center into room made by reserveShape
+static inline void writeCircle(SDL_FPoint* positions, SDL_FColor* colors, Uint16* indices, Uint16 baseIndex,
+                               float cx, float cy, float radius, int sides, SDL_FColor color) {
+    const SDL_FPoint* unit = unitCircle(sides);
+    positions[0] = {cx, cy};
+    colors[0] = color;
+    for (int i = 0; i < sides; ++i) {
+        positions[i + 1] = {cx + radius * unit[i].x, cy + radius * unit[i].y};
+        colors[i + 1] = color;
+    }
+    for (int i = 1; i <= sides; ++i) {
+        *indices++ = baseIndex;
+        *indices++ = (Uint16)(baseIndex + i);
+        *indices++ = (Uint16)(baseIndex + (i % sides) + 1);
+    }
+}
+
+void emitCircle(RenderData& data, float cx, float cy, float radius, int sides, SDL_FColor color) {
+    sides = std::clamp(sides, 3, MAX_CIRCLE_SIDES);
+    int firstVertex = data.vertexCount();
+    int firstIndex = data.indexCount();
+    Uint16 baseIndex = data.reserveShape(sides + 1, 3 * sides);
+    writeCircle(data.positions.data() + firstVertex, data.colors.data() + firstVertex, data.indices.data() + firstIndex,
+                baseIndex, cx, cy, radius, sides, color);
+}
+
+void emitPolygon(RenderData& data, const SDL_FPoint* points, int count, SDL_FColor color) {
+    if (count < 3) return;
+    Uint16 baseIndex = data.beginShape(count);
+    for (int i = 0; i < count; ++i) {
+        data.addVertex(points[i].x, points[i].y, color);
+    }
+    for (int i = 1; i < count - 1; ++i) {
+        data.indices.push_back(baseIndex);
+        data.indices.push_back(baseIndex + i);
+        data.indices.push_back(baseIndex + i + 1);
+    }
+}
+
+void emitLine(RenderData& data, float x1, float y1, float x2, float y2, float thickness, SDL_FColor color) {
     float dx = x2 - x1;
     float dy = y2 - y1;
     float length = std::sqrt(dx * dx + dy * dy); // moet sneller kunnen
     if (length == 0) return;
 
-    // normalize vector
-    float nx = dx / length;
-    float ny = dy / length;
+    // offset along the normal of the line, half the thickness to each side
     float half_thickness = thickness / 2.0f;
+    float ox = -dy / length * half_thickness;
+    float oy = dx / length * half_thickness;
+    SDL_FPoint corners[4] = {
+        {x1 + ox, y1 + oy}, {x1 - ox, y1 - oy}, {x2 - ox, y2 - oy}, {x2 + ox, y2 + oy}
+    };
+    emitQuad(data, corners, color);
+}
 
-    //hier gaan we de quad defineren
-    float r = color.r / 255.0f;
-    float g = color.g / 255.0f;
-    float b = color.b / 255.0f;
-    float a = color.a / 255.0f;
-
-    SDL_Vertex v1 = {{x1 + nx * half_thickness, y1 + nx * half_thickness}, {r, g, b, a}, {0.0f, 0.0f}};
-    SDL_Vertex v2 = {{x1 - nx * half_thickness, y1 - nx * half_thickness}, {r, g, b, a}, {0.0f, 0.0f}};
-    SDL_Vertex v3 = {{x2 - nx * half_thickness, y2 - nx * half_thickness}, {r, g, b, a}, {0.0f, 0.0f}};
-    SDL_Vertex v4 = {{x2 + nx * half_thickness, y2 + ny * half_thickness}, {r, g, b, a}, {0.0f, 0.0f}};
-
-    int baseIdx = data.vertices.size();
-    data.vertices.push_back(v1);
-    data.vertices.push_back(v2);
-    data.vertices.push_back(v3);
-    data.vertices.push_back(v4);
-
-    // append indices for two triangles 0 1 2, 2 3 0
-    data.indices.push_back(baseIdx + 0);
-    data.indices.push_back(baseIdx + 1);
-    data.indices.push_back(baseIdx + 2);
-    data.indices.push_back(baseIdx + 2);
-    data.indices.push_back(baseIdx + 3);
-    data.indices.push_back(baseIdx + 0);
+void Renderer::collectLineGeometry(float x1, float y1, float x2, float y2, SDL_Color color, RenderData& data, float thickness) {
+    emitLine(data, x1, y1, x2, y2, thickness, toFColor(color));
+}
+
+bool getConnectionLine(const Entity* parent, const Entity* app, SDL_FPoint& from, SDL_FPoint& to) {
+    int node = findNodeIndex(parent, app->coreNodeIndex);
+    if (node < 0) return false;
+    from = {parent->nodes[node].x, parent->nodes[node].y};
+
+    to = {app->Xpos, app->Ypos - app->height / 2.0f};  // Connect to top edge
+    if (app->isHandOrFoot) {
+        to.y = app->Ypos;  // Center for hands/feet
+    }
+    return true;
+}
+
+void Renderer::collectConnectionLineGeometry(Entity* parent, Entity* app, RenderData& data, SDL_Color color) {
+    SDL_FPoint from, to;
+    if (!getConnectionLine(parent, app, from, to)) return;
+    collectLineGeometry(from.x, from.y, to.x, to.y, color, data, CONNECTION_LINE_THICKNESS); // later thickness parameter beter uitwerken
 }
 
 void Renderer::collectConnectionLinesGeometry(Entity* entity, RenderData& data, SDL_Color color) {
     for (auto& app : entity->appendages) {
-        if (app->coreNodeIndex >= 0 && app->coreNodeIndex < entity->nodeCount) {
-            float nodeX = entity->nodes[app->coreNodeIndex].x;
-            float nodeY = entity->nodes[app->coreNodeIndex].y;
-
-            float appConnectX = app->Xpos;
-            float appConnectY = app->Ypos - app->height / 2.0f;  // Connect to top edge
-            if (app->isHandOrFoot) {
-                appConnectY = app->Ypos;  // Center for hands/feet
-            }
-            collectLineGeometry(nodeX, nodeY, appConnectX, appConnectY, color, data , 2.0f); // later thickness parameter beter uitwerken
+        if (findNodeIndex(entity, app->coreNodeIndex) >= 0) {
+            collectConnectionLineGeometry(entity, app.get(), data, color);
             collectConnectionLinesGeometry(app.get(), data, color);
         }
     }
 }
 
-void Renderer::drawFilledCircle(int cx, int cy, int radius, SDL_Color color, float rotation) {
-    const int sides = 32;
-    std::vector<SDL_Vertex> vertices;
-    std::vector<int> indices;
-    float angleStep = 2.0f * M_PI / sides;
+void Renderer::collectShapeGeometry(Entity* rootEntity, RenderData& data) {
+    collectShapeGeometry(makeShapeInstance(rootEntity), data);
+}
 
-    vertices.push_back({{(float)cx, (float)cy}, {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f}, {0.5f, 0.5f}});
+// One shape into its reserved room, the outline of its traits placed at the shape
+template <typename Traits>
+static inline void writeShape(const ShapeInstance& shape, SDL_FPoint* positions, SDL_FColor* colors, Uint16* indices,
+                              Uint16 baseIndex) {
+    SDL_FColor fc = toFColor(shape.color);
+    float hw = shape.width / 2.0f;
+    if constexpr (Traits::ROUND) {
+        static_assert(Traits::CIRCLE_SIDES <= MAX_CIRCLE_SIDES, "no unit circle table");
+        writeCircle(positions, colors, indices, baseIndex, shape.x, shape.y, hw, Traits::CIRCLE_SIDES, fc);
+    } else {
+        float hh = Traits::SQUARE ? hw : shape.height / 2.0f;
+        float c = std::cos(shape.rotation);
+        float s = std::sin(shape.rotation);
+        for (int i = 0; i < Traits::VERTEX_COUNT; ++i) {
+            float x = Traits::OUTLINE[i].x * hw;
+            float y = Traits::OUTLINE[i].y * hh;
+            positions[i] = {shape.x + x * c - y * s, shape.y + x * s + y * c};
+            colors[i] = fc;
+        }
+        for (int i = 0; i < Traits::INDEX_COUNT; ++i) {
+            indices[i] = (Uint16)(baseIndex + Traits::INDICES[i]);
+        }
+    }
+}
+
+void Renderer::collectShapeGeometry(const ShapeInstance& shape, RenderData& data) {
+    visitShape(shape.shapetype, [&](auto traits) {
+        using Traits = decltype(traits);
+        int firstVertex = data.vertexCount();
+        int firstIndex = data.indexCount();
+        Uint16 baseIndex = data.reserveShape(Traits::VERTEX_COUNT, Traits::INDEX_COUNT);
+        writeShape<Traits>(shape, data.positions.data() + firstVertex, data.colors.data() + firstVertex,
+                           data.indices.data() + firstIndex, baseIndex);
+    });
+}
 
-    for (int i = 0; i <= sides; ++i) {
-        float angle = i * angleStep + rotation;
-        float x = cx + radius * cos(angle);
-        float y = cy + radius * sin(angle);
-        vertices.push_back({{x, y}, {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f}, {0.5f + 0.5f * cos(angle), 0.5f + 0.5f * sin(angle)}});
+void ShapeBuckets::clear() {
+    for (auto& bucket : buckets_) {
+        bucket.clear();
     }
+}
 
-    for (int i = 1; i <= sides; ++i) {
-        indices.push_back(0);
-        indices.push_back(i);
-        indices.push_back(i + 1);
+void ShapeBuckets::add(RenderData& data, const ShapeInstance& shape) {
+    visitShape(shape.shapetype, [&](auto traits) {
+        using Traits = decltype(traits);
+        Reserved reserved = {&shape, data.vertexCount(), data.indexCount(), 0};
+        reserved.base = data.reserveShape(Traits::VERTEX_COUNT, Traits::INDEX_COUNT);
+        buckets_[Traits::SHAPE].push_back(reserved);
+    });
+}
+
+void ShapeBuckets::write(RenderData& data) const {
+    forEachShape([&](auto traits) {
+        using Traits = decltype(traits);
+        for (const Reserved& reserved : buckets_[Traits::SHAPE]) {
+            writeShape<Traits>(*reserved.shape, data.positions.data() + reserved.firstVertex,
+                               data.colors.data() + reserved.firstVertex, data.indices.data() + reserved.firstIndex,
+                               reserved.base);
+        }
+    });
+}
+
+void Renderer::collectNodeGeometry(Entity* rootEntity, RenderData& data) {
+    const SDL_FColor white = {1.0f, 1.0f, 1.0f, 1.0f};
+    for (int i = 0; i < rootEntity->nodeCount; ++i) {
+        emitCircle(data, rootEntity->nodes[i].x, rootEntity->nodes[i].y, NODE_MARKER_RADIUS, NODE_MARKER_SIDES, white);
     }
+}
 
-    renderGeometry(vertices.data(), vertices.size(), indices.data(), indices.size());
+void Renderer::clear(SDL_Color color) {
+    if (softRaster_) {
+        softRaster_->clear(color);
+        return;
+    }
+    setDrawColor(color);
+    SDL_RenderClear(sdl_renderer_);
 }
 
-void Renderer::drawFilledTriangle(SDL_Point p1, SDL_Point p2, SDL_Point p3, SDL_Color color, float rotation) {
-    if (rotation != 0.0f) {
-        float cx = (p1.x + p2.x + p3.x) / 3.0f;
-        float cy = (p1.y + p2.y + p3.y) / 3.0f;
-        auto rotatePoint = [&](SDL_Point& pt) {
-            float dx = pt.x - cx;
-            float dy = pt.y - cy;
-            pt.x = static_cast<int>(cx + dx * cos(rotation) - dy * sin(rotation));
-            pt.y = static_cast<int>(cy + dx * sin(rotation) + dy * cos(rotation));
-        };
-        rotatePoint(p1);
-        rotatePoint(p2);
-        rotatePoint(p3);
+void Renderer::setViewport(const SDL_Rect* rect) {
+    if (softRaster_) {
+        softRaster_->setViewport(rect);
+        return;
     }
+    SDL_SetRenderViewport(sdl_renderer_, rect);
+}
 
-    SDL_Vertex vertices[3] = {
-        {{(float)p1.x, (float)p1.y}, {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f}, {0.0f, 0.0f}},
-        {{(float)p2.x, (float)p2.y}, {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f}, {0.0f, 0.0f}},
-        {{(float)p3.x, (float)p3.y}, {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f}, {0.0f, 0.0f}}
-    };
-    int indices[3] = {0, 1, 2};
-    renderGeometry(vertices, 3, indices, 3);
+void Renderer::present() {
+    if (softRaster_) {
+        softRaster_->present(sdl_renderer_);
+    }
+    SDL_RenderPresent(sdl_renderer_);
 }
 
-void Renderer::drawEntity(Entity* entity) {
-    int Xpos = (int)entity->Xpos;
-    int Ypos = (int)entity->Ypos;
-    int width = entity->width;
-    int height = entity->height;
-    float rot = entity->rotation;
-    SDL_Color color = entity->isHandOrFoot ? SDL_Color{255, 255, 0, 255} : entity->color;
-    if (entity->texture) {
-        SDL_FRect dst = {entity->Xpos - entity->width / 2.0f, entity->Ypos - entity->height / 2.0f, 
-                        (float)entity->width, (float)entity->height};
-        renderTextureRotated(entity->texture, &dst, entity->rotation * 180.0f / M_PI, nullptr, SDL_FLIP_NONE);
-    } else {
-        switch (entity->shapetype) {
-            case RECTANGLE: {
-                SDL_Vertex vertices[4];
-                float hw = width / 2.0f;
-                float hh = height / 2.0f;
-                float cx = Xpos;
-                float cy = Ypos;
-                SDL_FPoint points[4] = {
-                    {-hw, -hh}, {hw, -hh}, {hw, hh}, {-hw, hh}
-                };
-                for (int i = 0; i < 4; ++i) {
-                    float rx = points[i].x * cos(rot) - points[i].y * sin(rot);
-                    float ry = points[i].x * sin(rot) + points[i].y * cos(rot);
-                    vertices[i].position.x = cx + rx;
-                    vertices[i].position.y = cy + ry;
-                    vertices[i].color.r = color.r / 255.0f;
-                    vertices[i].color.g = color.g / 255.0f;
-                    vertices[i].color.b = color.b / 255.0f;
-                    vertices[i].color.a = color.a / 255.0f;
-                }
-                int indices[6] = {0, 1, 2, 2, 3, 0};
-                renderGeometry(vertices, 4, indices, 6);
-                break;
-            }
-            case CIRCLE: {
-                drawFilledCircle(Xpos, Ypos, width / 2, color, 0.0f);
-                break;
-            }
-            case TRIANGLE: {
-                float s = width / 2.0f;
-                SDL_Point p1 = {(int)Xpos, (int)(Ypos - s)};
-                SDL_Point p2 = {(int)(Xpos - s), (int)(Ypos + s)};
-                SDL_Point p3 = {(int)(Xpos + s), (int)(Ypos + s)};
-                drawFilledTriangle(p1, p2, p3, color, rot);
-                break;
-            }
+void Renderer::renderBatchedGeometry(const RenderData& data, SDL_Texture* texture, const ViewTransform* view) {
+    if (softRaster_) {
+        if (!texture) softRaster_->draw(data, view);
+        return;
+    }
+    const SDL_FPoint* positions = data.positions.data();
+    if (view) {
+        viewPositions_.resize(data.positions.size());
+        for (size_t i = 0; i < data.positions.size(); ++i) {
+            viewPositions_[i].x = data.positions[i].x * view->scale + view->offsetX;
+            viewPositions_[i].y = data.positions[i].y * view->scale + view->offsetY;
         }
+        positions = viewPositions_.data();
+    }
+    bool textured = texture && !data.uvs.empty();
+    for (int i = 0; i < data.chunkCount(); ++i) {
+        const RenderChunk& chunk = data.chunks[i];
+        const SDL_FPoint* uvs = textured ? data.uvs.data() + chunk.firstVertex : nullptr;
+        renderGeometry(positions + chunk.firstVertex, data.colors.data() + chunk.firstVertex, uvs,
+                       data.chunkVertexCount(i), data.indices.data() + chunk.firstIndex, data.chunkIndexCount(i), texture);
     }
 }
 
-void Renderer::collectAllGeometry(Entity* rootEntity, RenderData& data, bool includeNodes) {
+void Renderer::renderRange(const RenderData& data, const RenderRange& range, SDL_Texture* texture, const ViewTransform* view) {
+    if (softRaster_) {
+        if (!texture) softRaster_->drawRange(data, range.chunk, range.firstIndex, range.indexCount, view);
+        return;
+    }
+    // Indices are relative to the chunk start, vertices before firstVertex are not referenced
+    int chunkStart = data.chunks[range.chunk].firstVertex;
+    int numVertices = range.vertexEnd - chunkStart;
+    const SDL_FPoint* positions = data.positions.data() + chunkStart;
+    if (view) {
+        viewPositions_.resize(numVertices);
+        for (int i = range.firstVertex - chunkStart; i < numVertices; ++i) {
+            viewPositions_[i].x = positions[i].x * view->scale + view->offsetX;
+            viewPositions_[i].y = positions[i].y * view->scale + view->offsetY;
+        }
+        positions = viewPositions_.data();
+    }
+    const SDL_FPoint* uvs = texture && !data.uvs.empty() ? data.uvs.data() + chunkStart : nullptr;
+    renderGeometry(positions, data.colors.data() + chunkStart, uvs, numVertices,
+                   data.indices.data() + range.firstIndex, range.indexCount, texture);
+}
+
+void Renderer::collectAllGeometry(Entity* rootEntity, RenderData& data, bool includeNodes, const SDL_FRect* cullRect) {
     if (!rootEntity) return;
 
-    Uint16 baseIndex = static_cast<Uint16>(data.vertices.size());
-    SDL_Color color = rootEntity->isHandOrFoot ? SDL_Color{255, 255, 0, 255} : rootEntity->color;
-
-    switch (rootEntity->shapetype) {
-        case RECTANGLE: {
-            float hw = rootEntity->width / 2.0f;
-            float hh = rootEntity->height / 2.0f;
-            float cx = rootEntity->Xpos;
-            float cy = rootEntity->Ypos;
-            float rot = rootEntity->rotation;
-            SDL_FPoint points[4] = {
-                {-hw, -hh}, {hw, -hh}, {hw, hh}, {-hw, hh}
-            };
-            for (int i = 0; i < 4; ++i) {
-                float rx = points[i].x * cos(rot) - points[i].y * sin(rot);
-                float ry = points[i].x * sin(rot) + points[i].y * cos(rot);
-                data.vertices.push_back({{cx + rx, cy + ry}, 
-                                        {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f}, 
-                                        {0.0f, 0.0f}});
-            }
-            data.indices.insert(data.indices.end(), 
-                              {baseIndex, baseIndex + 1, baseIndex + 2, 
-                               baseIndex + 2, baseIndex + 3, baseIndex});
-            break;
-        }
-        case CIRCLE: {
-            int radius = rootEntity->width / 2;
-            int cx = static_cast<int>(rootEntity->Xpos);
-            int cy = static_cast<int>(rootEntity->Ypos);
-            const int sides = 32;
-            float angleStep = 2.0f * M_PI / sides;
-            data.vertices.push_back({{(float)cx, (float)cy}, 
-                                    {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f}, 
-                                    {0.5f, 0.5f}});
-            for (int i = 0; i <= sides; ++i) {
-                float angle = i * angleStep + rootEntity->rotation;
-                float x = cx + radius * cos(angle);
-                float y = cy + radius * sin(angle);
-                data.vertices.push_back({{x, y}, 
-                                        {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f}, 
-                                        {0.5f + 0.5f * cos(angle), 0.5f + 0.5f * sin(angle)}});
-            }
-            for (int i = 1; i <= sides; ++i) {
-                data.indices.push_back(baseIndex);
-                data.indices.push_back(baseIndex + i);
-                data.indices.push_back(baseIndex + (i % sides) + 1);
-            }
-            break;
-        }
-        case TRIANGLE: {
-            float s = rootEntity->width / 2.0f;
-            float cx = rootEntity->Xpos;
-            float cy = rootEntity->Ypos;
-            float rot = rootEntity->rotation;
-            SDL_FPoint p1 = {0.0f, -s};
-            SDL_FPoint p2 = {-s, s};
-            SDL_FPoint p3 = {s, s};
-            SDL_FPoint rp1, rp2, rp3;
-            rp1.x = cx + (p1.x * cos(rot) - p1.y * sin(rot));
-            rp1.y = cy + (p1.x * sin(rot) + p1.y * cos(rot));
-            rp2.x = cx + (p2.x * cos(rot) - p2.y * sin(rot));
-            rp2.y = cy + (p2.x * sin(rot) + p2.y * cos(rot));
-            rp3.x = cx + (p3.x * cos(rot) - p3.y * sin(rot));
-            rp3.y = cy + (p3.x * sin(rot) + p3.y * cos(rot));
-            data.vertices.push_back({{rp1.x, rp1.y}, {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f}, {0.0f, 0.0f}});
-            data.vertices.push_back({{rp2.x, rp2.y}, {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f}, {0.0f, 0.0f}});
-            data.vertices.push_back({{rp3.x, rp3.y}, {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f}, {0.0f, 0.0f}});
-            data.indices.insert(data.indices.end(), {baseIndex, baseIndex + 1, baseIndex + 2});
-            break;
+    if (!cullRect || rectsOverlap(*cullRect, getShapeBounds(rootEntity))) {
+        collectShapeGeometry(rootEntity, data);
+        if (includeNodes) {
+            collectNodeGeometry(rootEntity, data);
         }
     }
-
     if (includeNodes) {
-        for (int i = 0; i < rootEntity->nodeCount; ++i) {
-            float nx = rootEntity->nodes[i].x;
-            float ny = rootEntity->nodes[i].y;
-            int nodeRadius = 3;
-            Uint16 nodeBase = static_cast<Uint16>(data.vertices.size());
-            data.vertices.push_back({{nx, ny}, {1.0f, 1.0f, 1.0f, 1.0f}, {0.5f, 0.5f}});
-            const int nodeSides = 8;
-            for (int j = 0; j <= nodeSides; ++j) {
-                float angle = (2 * M_PI * j) / nodeSides;
-                float vx = nx + nodeRadius * cos(angle);
-                float vy = ny + nodeRadius * sin(angle);
-                data.vertices.push_back({{vx, vy}, {1.0f, 1.0f, 1.0f, 1.0f}, {0.5f + 0.5f * cos(angle), 0.5f + 0.5f * sin(angle)}});
-            }
-            for (int j = 1; j <= nodeSides; ++j) {
-                Uint16 c = nodeBase;
-                Uint16 p1 = nodeBase + j;
-                Uint16 p2 = nodeBase + (j % nodeSides) + 1;
-                data.indices.insert(data.indices.end(), {c, p1, p2});
-            }
-        }
         SDL_Color lineColor = {255, 255, 255, 255};  // hier pakken we de lijnen van de nodes
-        collectConnectionLinesGeometry(rootEntity, data, lineColor);
+        for (auto& app : rootEntity->appendages) {
+            collectConnectionLineGeometry(rootEntity, app.get(), data, lineColor);
+        }
     }
 
     for (auto& app : rootEntity->appendages) {
-        collectAllGeometry(app.get(), data, includeNodes);
+        collectAllGeometry(app.get(), data, includeNodes, cullRect);
+    }
+}
+
+// Hands and feet are animated every frame (updateHands, walking), everything else
+// stays rigid relative to its root and can be baked by the sprite cache.
+void Renderer::collectStaticGeometry(Entity* entity, RenderData& data) {
+    collectShapeGeometry(entity, data);
+    collectNodeGeometry(entity, data);
+    SDL_Color lineColor = {255, 255, 255, 255};
+    for (auto& app : entity->appendages) {
+        if (app->isHandOrFoot) continue;
+        collectConnectionLineGeometry(entity, app.get(), data, lineColor);
+        collectStaticGeometry(app.get(), data);
+    }
+}
+
+void Renderer::collectDynamicGeometry(Entity* entity, RenderData& data, bool includeNodes, const SDL_FRect* cullRect) {
+    SDL_Color lineColor = {255, 255, 255, 255};
+    for (auto& app : entity->appendages) {
+        if (app->isHandOrFoot) {
+            if (includeNodes) {
+                collectConnectionLineGeometry(entity, app.get(), data, lineColor);
+            }
+            collectAllGeometry(app.get(), data, includeNodes, cullRect);
+        } else {
+            collectDynamicGeometry(app.get(), data, includeNodes, cullRect);
+        }
     }
 }
 
@@ -271,13 +325,10 @@ void Renderer::collectUIGeometry(const std::vector<InputManager::ShapeButton>& s
                                 const InputManager::ShapeButton& removeNodeBtn,
                                 RenderData& data) {
     auto addRect = [&](const SDL_FRect& rect, SDL_Color color) {
-        Uint16 baseIndex = static_cast<Uint16>(data.vertices.size());
-        float x = rect.x, y = rect.y, w = rect.w, h = rect.h;
-        data.vertices.push_back({{x, y}, {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f}, {0.0f, 0.0f}});
-        data.vertices.push_back({{x + w, y}, {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f}, {0.0f, 0.0f}});
-        data.vertices.push_back({{x + w, y + h}, {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f}, {0.0f, 0.0f}});
-        data.vertices.push_back({{x, y + h}, {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f}, {0.0f, 0.0f}});
-        data.indices.insert(data.indices.end(), {baseIndex, baseIndex + 1, baseIndex + 2, baseIndex + 2, baseIndex + 3, baseIndex});
+        SDL_FPoint corners[4] = {
+            {rect.x, rect.y}, {rect.x + rect.w, rect.y}, {rect.x + rect.w, rect.y + rect.h}, {rect.x, rect.y + rect.h}
+        };
+        emitQuad(data, corners, toFColor(color));
     };
 
     for (const auto& btn : shapeButtons) {
@@ -293,100 +344,10 @@ void Renderer::collectUIGeometry(const std::vector<InputManager::ShapeButton>& s
 void collectEntityGeometry(Entity* entity, std::vector<RenderBatch>& batches) {
     RenderBatch batch;
     batch.shapeType = entity->shapetype;
-    int baseIndex = 0;
-
-    SDL_Color color = entity->isHandOrFoot ? SDL_Color{255, 255, 0, 255} : entity->color;
-
-    switch (entity->shapetype) {
-        case RECTANGLE: {
-            float hw = entity->width / 2.0f;
-            float hh = entity->height / 2.0f;
-            float cx = entity->Xpos;
-            float cy = entity->Ypos;
-            float rot = entity->rotation;
-            SDL_FPoint points[4] = {
-                {-hw, -hh}, {hw, -hh}, {hw, hh}, {-hw, hh}
-            };
-            for (int i = 0; i < 4; ++i) {
-                float rx = points[i].x * cos(rot) - points[i].y * sin(rot);
-                float ry = points[i].x * sin(rot) + points[i].y * cos(rot);
-                SDL_Vertex v = {{cx + rx, cy + ry}, {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f}, {0.0f, 0.0f}};
-                batch.vertices.push_back(v);
-            }
-            batch.indices = {0, 1, 2, 2, 3, 0};
-            break;
-        }
-        case CIRCLE: {
-            int radius = entity->width / 2;
-            int cx = static_cast<int>(entity->Xpos);
-            int cy = static_cast<int>(entity->Ypos);
-            const int sides = 32;
-            float angleStep = 2.0f * M_PI / sides;
-
-            batch.vertices.push_back({{(float)cx, (float)cy}, 
-                                     {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f}, 
-                                     {0.5f, 0.5f}});
-
-            for (int i = 0; i <= sides; ++i) {
-                float angle = i * angleStep + entity->rotation;
-                float x = cx + radius * cos(angle);
-                float y = cy + radius * sin(angle);
-                batch.vertices.push_back({{x, y}, 
-                                         {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f}, 
-                                         {0.5f + 0.5f * cos(angle), 0.5f + 0.5f * sin(angle)}});
-            }
-
-            for (int i = 1; i <= sides; ++i) {
-                batch.indices.push_back(0);
-                batch.indices.push_back(i);
-                batch.indices.push_back(i + 1);
-            }
-            break;
-        }
-        case TRIANGLE: {
-            float s = entity->width / 2.0f;
-            float cx = entity->Xpos;
-            float cy = entity->Ypos;
-            float rot = entity->rotation;
-            SDL_FPoint p1 = {0.0f, -s};
-            SDL_FPoint p2 = {-s, s};
-            SDL_FPoint p3 = {s, s};
-            SDL_FPoint rp1, rp2, rp3;
-            rp1.x = cx + (p1.x * cos(rot) - p1.y * sin(rot));
-            rp1.y = cy + (p1.x * sin(rot) + p1.y * cos(rot));
-            rp2.x = cx + (p2.x * cos(rot) - p2.y * sin(rot));
-            rp2.y = cy + (p2.x * sin(rot) + p2.y * cos(rot));
-            rp3.x = cx + (p3.x * cos(rot) - p3.y * sin(rot));
-            rp3.y = cy + (p3.x * sin(rot) + p3.y * cos(rot));
-            SDL_Vertex v1 = {{rp1.x, rp1.y}, {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f}, {0.0f, 0.0f}};
-            SDL_Vertex v2 = {{rp2.x, rp2.y}, {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f}, {0.0f, 0.0f}};
-            SDL_Vertex v3 = {{rp3.x, rp3.y}, {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f}, {0.0f, 0.0f}};
-            batch.vertices = {v1, v2, v3};
-            batch.indices = {0, 1, 2};
-            break;
-        }
-    }
-    batches.push_back(batch);
+    Renderer::collectShapeGeometry(entity, batch.data);
+    batches.push_back(std::move(batch));
 
     for (auto& app : entity->appendages) {
         collectEntityGeometry(app.get(), batches);
     }
 }
-
-void Renderer::drawEntityWithNodesAndLines(Entity* entity) {
-    drawEntity(entity);
-    setDrawColor({255, 255, 255, 255});
-    for (int i = 0; i < entity->nodeCount; ++i) {
-        SDL_FRect nodeRect = {entity->nodes[i].x - 3, entity->nodes[i].y - 3, 6, 6};
-        fillRect(&nodeRect);
-    }
-    for (auto& app : entity->appendages) {
-        if (app->coreNodeIndex >= 0 && app->coreNodeIndex < entity->nodeCount) {
-            setDrawColor({255, 255, 255, 255});
-            SDL_FPoint coreNode = {entity->nodes[app->coreNodeIndex].x, entity->nodes[app->coreNodeIndex].y};
-            SDL_FPoint appEdge = {app->Xpos, app->Ypos - app->height / 2.0f};
-            drawLine(coreNode.x, coreNode.y, appEdge.x, appEdge.y);
-            drawEntityWithNodesAndLines(app.get());
-        }
-    }
-}
\ No newline at end of file
@@ -5,63 +5,238 @@
 #include <vector>
 #include "entity.h" // For Entity, Shape, SDL_Color, etc.
 #include "InputManager.h"
+#include "camera.h"
 
-struct RenderBatch {
-    std::vector<SDL_Vertex> vertices;
-    std::vector<int> indices;
-    Shape shapeType;
+// Start of a run of vertices/indices that is submitted as one draw call. Indices
+// inside a chunk are relative to its firstVertex, so they always fit in 16 bits.
+struct RenderChunk {
+    int firstVertex;
+    int firstIndex;
+};
+
+// Part of one chunk of a RenderData, e.g. the triangles of one shape. Indices are
+// chunk-relative like in RenderData and only reference [firstVertex, vertexEnd).
+struct RenderRange {
+    int chunk;
+    int firstVertex;
+    int vertexEnd;
+    int firstIndex;
+    int indexCount;
 };
 
+// Geometry in separate streams for SDL_RenderGeometryRaw: positions and colors are
+// always filled, uvs only for textured data (sprites), indices are 16 bit and
+// chunk-relative. Scenes of any size are split into chunks automatically.
 struct RenderData {
-    std::vector<SDL_Vertex> vertices;
-    std::vector<int> indices; // Use int for indices
+    static constexpr int MAX_CHUNK_VERTICES = 65536;
+
+    std::vector<SDL_FPoint> positions;
+    std::vector<SDL_FColor> colors;
+    std::vector<SDL_FPoint> uvs;
+    std::vector<Uint16> indices;
+    std::vector<RenderChunk> chunks;
+
     void clear() {
-        vertices.clear();
+        positions.clear();
+        colors.clear();
+        uvs.clear();
         indices.clear();
+        chunks.clear();
+    }
+    void reserve(int numVertices, int numIndices) {
+        positions.reserve(numVertices);
+        colors.reserve(numVertices);
+        indices.reserve(numIndices);
+    }
+    int vertexCount() const { return (int)positions.size(); }
+    int indexCount() const { return (int)indices.size(); }
+    int chunkCount() const { return (int)chunks.size(); }
+    int chunkVertexCount(int chunk) const {
+        int end = chunk + 1 < chunkCount() ? chunks[chunk + 1].firstVertex : vertexCount();
+        return end - chunks[chunk].firstVertex;
+    }
+    int chunkIndexCount(int chunk) const {
+        int end = chunk + 1 < chunkCount() ? chunks[chunk + 1].firstIndex : indexCount();
+        return end - chunks[chunk].firstIndex;
+    }
+    // Call before adding a shape's vertices, returns the chunk-relative index of the
+    // first one. Opens a new chunk when the shape would not fit in the current one.
+    Uint16 beginShape(int numVertices) {
+        if (chunks.empty() || vertexCount() - chunks.back().firstVertex + numVertices > MAX_CHUNK_VERTICES) {
+            chunks.push_back({vertexCount(), indexCount()});
+        }
+        return static_cast<Uint16>(vertexCount() - chunks.back().firstVertex);
+    }
+    // Copies other's geometry behind ours, chunk by chunk so indices stay valid
+    void append(const RenderData& other) {
+        bool withUvs = !other.uvs.empty();
+        for (int i = 0; i < other.chunkCount(); ++i) {
+            const RenderChunk& chunk = other.chunks[i];
+            int numVertices = other.chunkVertexCount(i);
+            Uint16 base = beginShape(numVertices);
+            positions.insert(positions.end(), other.positions.begin() + chunk.firstVertex,
+                             other.positions.begin() + chunk.firstVertex + numVertices);
+            colors.insert(colors.end(), other.colors.begin() + chunk.firstVertex,
+                          other.colors.begin() + chunk.firstVertex + numVertices);
+            if (withUvs) {
+                uvs.insert(uvs.end(), other.uvs.begin() + chunk.firstVertex,
+                           other.uvs.begin() + chunk.firstVertex + numVertices);
+            }
+            int firstIndex = chunk.firstIndex;
+            int numIndices = other.chunkIndexCount(i);
+            for (int j = 0; j < numIndices; ++j) {
+                indices.push_back(static_cast<Uint16>(base + other.indices[firstIndex + j]));
+            }
+        }
     }
+    // Range covering everything added since the given counts, for recording a shape
+    // right after emitting it. Shapes never cross a chunk, so when the shape opened a
+    // new chunk the range starts there.
+    RenderRange rangeSince(int vertexStart, int indexStart) const {
+        int chunk = chunkCount() - 1;
+        if (chunk < 0) return {0, vertexStart, vertexStart, indexStart, 0};
+        vertexStart = std::max(vertexStart, chunks[chunk].firstVertex);
+        indexStart = std::max(indexStart, chunks[chunk].firstIndex);
+        return {chunk, vertexStart, vertexCount(), indexStart, indexCount() - indexStart};
+    }
+    // Copies a range behind our geometry
+    void appendRange(const RenderData& other, const RenderRange& range) {
+        int numVertices = range.vertexEnd - range.firstVertex;
+        bool withUvs = !other.uvs.empty();
+        Uint16 base = beginShape(numVertices);
+        positions.insert(positions.end(), other.positions.begin() + range.firstVertex, other.positions.begin() + range.vertexEnd);
+        colors.insert(colors.end(), other.colors.begin() + range.firstVertex, other.colors.begin() + range.vertexEnd);
+        if (withUvs) {
+            uvs.insert(uvs.end(), other.uvs.begin() + range.firstVertex, other.uvs.begin() + range.vertexEnd);
+        }
+        int rebase = base - (range.firstVertex - other.chunks[range.chunk].firstVertex);
+        for (int j = 0; j < range.indexCount; ++j) {
+            indices.push_back(static_cast<Uint16>(rebase + other.indices[range.firstIndex + j]));
+        }
+    }
+    // Room for a shape that is written later, in draw order. Returns the chunk-relative
+    // index of its first vertex like beginShape.
+    Uint16 reserveShape(int numVertices, int numIndices) {
+        Uint16 base = beginShape(numVertices);
+        positions.resize(positions.size() + numVertices);
+        colors.resize(colors.size() + numVertices);
+        indices.resize(indices.size() + numIndices);
+        return base;
+    }
+    void addVertex(float x, float y, const SDL_FColor& color) {
+        positions.push_back({x, y});
+        colors.push_back(color);
+    }
+    void addVertex(float x, float y, const SDL_FColor& color, SDL_FPoint uv) {
+        addVertex(x, y, color);
+        uvs.push_back(uv);
+    }
+};
+
+// What collectShapeGeometry needs from an Entity, copied out so geometry can be
+// built without touching the entity tree (render snapshots)
+struct ShapeInstance {
+    Shape shapetype;
+    float x, y;
+    float width, height;
+    float rotation;
+    SDL_Color color;
 };
 
+inline ShapeInstance makeShapeInstance(const Entity* entity) {
+    SDL_Color color = entity->isHandOrFoot ? SDL_Color{255, 255, 0, 255} : entity->color;
+    return {entity->shapetype, entity->Xpos, entity->Ypos, (float)entity->width, (float)entity->height, entity->rotation, color};
+}
+
+// Shapes whose room is reserved in draw order, grouped by shape type so write() fills
+// them in with one loop per type. Gives the same geometry as collectShapeGeometry.
+class ShapeBuckets {
+public:
+    void clear();
+    // Keeps a pointer to shape until write()
+    void add(RenderData& data, const ShapeInstance& shape);
+    void write(RenderData& data) const;
+
+private:
+    struct Reserved {
+        const ShapeInstance* shape;
+        int firstVertex;
+        int firstIndex;
+        Uint16 base;
+    };
+    std::vector<Reserved> buckets_[SHAPE_COUNT];
+};
+
+struct RenderBatch {
+    RenderData data;
+    Shape shapeType;
+};
+
+// Converted once per shape instead of once per vertex
+inline SDL_FColor toFColor(SDL_Color color) {
+    const float scale = 1.0f / 255.0f;
+    return {color.r * scale, color.g * scale, color.b * scale, color.a * scale};
+}
+
+class SoftRasterizer;
+
 class Renderer {
 private:
     SDL_Renderer* sdl_renderer_;
+    SoftRasterizer* softRaster_ = nullptr;
+    std::vector<SDL_FPoint> viewPositions_; // Scratch for world geometry moved into view space
 
 public:
     Renderer(SDL_Renderer* sdl_renderer) : sdl_renderer_(sdl_renderer) {}
 
     SDL_Renderer* getSDLRenderer() const { return sdl_renderer_; }
+    // When set, clear/renderBatchedGeometry/present go through the CPU rasterizer.
+    // Textured geometry is skipped in that mode.
+    void setSoftRasterizer(SoftRasterizer* softRaster) { softRaster_ = softRaster; }
+    SoftRasterizer* getSoftRasterizer() const { return softRaster_; }
 
     void collectLineGeometry(float x1, float y1, float x2, float y2, SDL_Color color, RenderData& data, float thickness);
+    void collectConnectionLineGeometry(Entity* parent, Entity* app, RenderData& data, SDL_Color color);
     void collectConnectionLinesGeometry(Entity* entity, RenderData& data, SDL_Color color);
 
     void setDrawColor(SDL_Color color) {
         SDL_SetRenderDrawColor(sdl_renderer_, color.r, color.g, color.b, color.a);
     }
 
-    void clear(SDL_Color color) {
-        setDrawColor(color);
-        SDL_RenderClear(sdl_renderer_);
-    }
-
-    void present() {
-        SDL_RenderPresent(sdl_renderer_);
-    }
+    void clear(SDL_Color color);
+    void present();
+    // Draws after this go to rect (window coordinates, geometry relative to its corner),
+    // null is the whole target. Clear ignores it, like SDL_RenderClear.
+    void setViewport(const SDL_Rect* rect);
 
     void drawLine(float x1, float y1, float x2, float y2) {
         SDL_RenderLine(sdl_renderer_, x1, y1, x2, y2);
     }
 
-    void renderGeometry(const SDL_Vertex* vertices, int num_vertices, const int* indices, int num_indices) {
-        SDL_RenderGeometry(sdl_renderer_, nullptr, vertices, num_vertices, indices, num_indices);
+    void renderGeometry(const SDL_FPoint* positions, const SDL_FColor* colors, const SDL_FPoint* uvs, int num_vertices,
+                        const Uint16* indices, int num_indices, SDL_Texture* texture = nullptr) {
+        SDL_RenderGeometryRaw(sdl_renderer_, texture,
+                              &positions->x, sizeof(SDL_FPoint),
+                              colors, sizeof(SDL_FColor),
+                              uvs ? &uvs->x : nullptr, sizeof(SDL_FPoint),
+                              num_vertices, indices, num_indices, sizeof(Uint16));
     }
 
-    void renderBatchedGeometry(const RenderData& data) {
-        if (!data.vertices.empty()) {
-            renderGeometry(data.vertices.data(), data.vertices.size(), data.indices.data(), data.indices.size());
-        }
+    // Submits every chunk of data, optionally moving positions through a view transform first
+    void renderBatchedGeometry(const RenderData& data, SDL_Texture* texture = nullptr, const ViewTransform* view = nullptr);
+    // Submits one range without copying it
+    void renderRange(const RenderData& data, const RenderRange& range, SDL_Texture* texture = nullptr, const ViewTransform* view = nullptr);
+
+    void setDrawBlendMode(SDL_BlendMode blendMode) {
+        SDL_SetRenderDrawBlendMode(sdl_renderer_, blendMode);
+    }
+
+    void renderTexture(SDL_Texture* texture, const SDL_FRect* src, const SDL_FRect* dst) {
+        SDL_RenderTexture(sdl_renderer_, texture, src, dst);
     }
 
-    void renderTextureRotated(SDL_Texture* texture, const SDL_FRect* dst, double angle, const SDL_FPoint* point, SDL_FlipMode flip) {
-        SDL_RenderTextureRotated(sdl_renderer_, texture, nullptr, dst, angle, point, flip);
+    void renderTextureRotated(SDL_Texture* texture, const SDL_FRect* src, const SDL_FRect* dst, double angle, const SDL_FPoint* point, SDL_FlipMode flip) {
+        SDL_RenderTextureRotated(sdl_renderer_, texture, src, dst, angle, point, flip);
     }
 
     void drawRect(const SDL_FRect* rect) {
@@ -88,11 +263,27 @@ public:
         SDL_SetRenderTarget(sdl_renderer_, texture);
     }
 
-    void drawFilledCircle(int cx, int cy, int radius, SDL_Color color, float rotation);
-    void drawFilledTriangle(SDL_Point p1, SDL_Point p2, SDL_Point p3, SDL_Color color, float rotation);
-    void drawEntity(Entity* entity);
-    void drawEntityWithNodesAndLines(Entity* entity);
-    void collectAllGeometry(Entity* rootEntity, RenderData& data, bool includeNodes = true);
+    // Copy of the current render target, caller destroys it
+    SDL_Surface* readPixels() {
+        return SDL_RenderReadPixels(sdl_renderer_, nullptr);
+    }
+
+    void getOutputSize(int* w, int* h) const {
+        SDL_GetRenderOutputSize(sdl_renderer_, w, h);
+    }
+
+    // Executes the queued commands now instead of at present
+    void flush() {
+        SDL_FlushRenderer(sdl_renderer_);
+    }
+
+    static void collectShapeGeometry(Entity* entity, RenderData& data);
+    static void collectShapeGeometry(const ShapeInstance& shape, RenderData& data);
+    static void collectNodeGeometry(Entity* entity, RenderData& data);
+    // cullRect (world space) skips the shapes and node markers of entities outside it
+    void collectAllGeometry(Entity* rootEntity, RenderData& data, bool includeNodes = true, const SDL_FRect* cullRect = nullptr);
+    void collectStaticGeometry(Entity* entity, RenderData& data);
+    void collectDynamicGeometry(Entity* entity, RenderData& data, bool includeNodes = true, const SDL_FRect* cullRect = nullptr);
     void collectUIGeometry(const std::vector<InputManager::ShapeButton>& shapeButtons,
                           const std::vector<InputManager::EditModeButton>& editModeButtons,
                           const InputManager::ShapeButton& addNodeBtn,
@@ -102,4 +293,19 @@ public:
 
 void collectEntityGeometry(Entity* entity, std::vector<RenderBatch>& batches);
 
+// Node markers and the lines from a node to its appendage
+constexpr float NODE_MARKER_RADIUS = 3.0f;
+constexpr int NODE_MARKER_SIDES = 8;
+constexpr float CONNECTION_LINE_THICKNESS = 2.0f;
+// From the parent's node to the appendage, false if app isn't attached to a valid node
+bool getConnectionLine(const Entity* parent, const Entity* app, SDL_FPoint& from, SDL_FPoint& to);
+
+// Shared primitive emitters, used by the collectors and DrawList
+constexpr int MAX_CIRCLE_SIDES = 64;
+void emitQuad(RenderData& data, const SDL_FPoint corners[4], SDL_FColor color);
+void emitTriangle(RenderData& data, SDL_FPoint p1, SDL_FPoint p2, SDL_FPoint p3, SDL_FColor color);
+void emitCircle(RenderData& data, float cx, float cy, float radius, int sides, SDL_FColor color);
+void emitPolygon(RenderData& data, const SDL_FPoint* points, int count, SDL_FColor color); // convex, as a fan
+void emitLine(RenderData& data, float x1, float y1, float x2, float y2, float thickness, SDL_FColor color);
+
 #endif // RENDERER_H
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include "renderpipeline.h"
+
+void captureAllGeometry(Entity* rootEntity, RenderSnapshot& snapshot, bool includeNodes, const SDL_FRect* cullRect) {
+    if (!rootEntity) return;
+
+    if (!cullRect || rectsOverlap(*cullRect, getShapeBounds(rootEntity))) {
+        SnapshotItem item = {SnapshotItem::SHAPE, snapshot.depth, makeShapeInstance(rootEntity), {}, {}};
+        snapshot.items.push_back(item);
+        if (includeNodes) {
+            item.kind = SnapshotItem::NODE;
+            for (int i = 0; i < rootEntity->nodeCount; ++i) {
+                item.p1 = {rootEntity->nodes[i].x, rootEntity->nodes[i].y};
+                snapshot.items.push_back(item);
+            }
+        }
+    }
+    if (includeNodes) {
+        SnapshotItem item = {SnapshotItem::LINE, snapshot.depth, {}, {}, {}};
+        for (auto& app : rootEntity->appendages) {
+            if (getConnectionLine(rootEntity, app.get(), item.p1, item.p2)) {
+                snapshot.items.push_back(item);
+            }
+        }
+    }
+
+    for (auto& app : rootEntity->appendages) {
+        captureAllGeometry(app.get(), snapshot, includeNodes, cullRect);
+    }
+}
+
+void captureDynamicGeometry(Entity* entity, RenderSnapshot& snapshot, bool includeNodes, const SDL_FRect* cullRect) {
+    for (auto& app : entity->appendages) {
+        if (app->isHandOrFoot) {
+            SnapshotItem item = {SnapshotItem::LINE, snapshot.depth, {}, {}, {}};
+            if (includeNodes && getConnectionLine(entity, app.get(), item.p1, item.p2)) {
+                snapshot.items.push_back(item);
+            }
+            captureAllGeometry(app.get(), snapshot, includeNodes, cullRect);
+        } else {
+            captureDynamicGeometry(app.get(), snapshot, includeNodes, cullRect);
+        }
+    }
+}
+
+// Preorder visits the parts in the order of the recursive capture: a part's shape
+// and nodes, the lines to its children, then the children's subtrees
+void captureBlueprintGeometry(const CreatureBlueprint& blueprint, const CreaturePose* poses, RenderSnapshot& snapshot,
+                              bool includeNodes, const SDL_FRect* cullRect, bool dynamicOnly) {
+    for (int i = 0; i < blueprint.getPartCount(); ++i) {
+        const CreatureBlueprint::Part& part = blueprint.getPart(i);
+        if (dynamicOnly && !(part.flags & CreatureBlueprint::DYNAMIC)) continue;
+        const CreaturePose& pose = poses[i];
+        SnapshotItem item = {SnapshotItem::LINE, snapshot.depth, {}, {}, {}};
+        if (dynamicOnly && includeNodes && (part.flags & CreatureBlueprint::DYNAMIC_ROOT) &&
+            blueprint.getAttachPoint(poses, i, item.p1)) {
+            item.p2 = {pose.x, pose.y};
+            snapshot.items.push_back(item);
+        }
+
+        float r = part.boundsRadius;
+        if (!cullRect || rectsOverlap(*cullRect, {pose.x - r, pose.y - r, 2.0f * r, 2.0f * r})) {
+            item.kind = SnapshotItem::SHAPE;
+            item.shape = {part.shape, pose.x, pose.y, part.width, part.height, pose.rotation, part.color};
+            snapshot.items.push_back(item);
+            if (includeNodes) {
+                item.kind = SnapshotItem::NODE;
+                for (Uint32 n = 0; n < part.nodeCount; ++n) {
+                    item.p1 = blueprint.getNode(poses, i, (int)n);
+                    snapshot.items.push_back(item);
+                }
+            }
+        }
+        if (includeNodes) {
+            item.kind = SnapshotItem::LINE;
+            const Uint32* children = blueprint.getChildren(i);
+            for (Uint32 c = 0; c < part.childCount; ++c) {
+                const CreatureBlueprint::Part& child = blueprint.getPart(children[c]);
+                const CreaturePose& childPose = poses[children[c]];
+                if (blueprint.getAttachPoint(poses, children[c], item.p1)) {
+                    // Top edge, center for hands/feet (getConnectionLine)
+                    bool center = (child.flags & CreatureBlueprint::HAND_OR_FOOT) != 0;
+                    item.p2 = {childPose.x, center ? childPose.y : childPose.y - child.height / 2.0f};
+                    snapshot.items.push_back(item);
+                }
+            }
+        }
+    }
+}
+
+void buildSnapshotGeometry(const RenderSnapshot& snapshot, RenderData& world, std::vector<SnapshotRange>& worldRanges,
+                           RenderData& debug, ShapeBuckets& shapes) {
+    const SDL_FColor white = {1.0f, 1.0f, 1.0f, 1.0f};
+    world.clear();
+    worldRanges.clear();
+    debug.clear();
+    shapes.clear();
+    for (const SnapshotItem& item : snapshot.items) {
+        int vertexStart = world.vertexCount();
+        int indexStart = world.indexCount();
+        switch (item.kind) {
+            case SnapshotItem::SHAPE:
+                shapes.add(world, item.shape);
+                break;
+            case SnapshotItem::NODE:
+                emitCircle(world, item.p1.x, item.p1.y, NODE_MARKER_RADIUS, NODE_MARKER_SIDES, white);
+                break;
+            case SnapshotItem::LINE:
+                emitLine(world, item.p1.x, item.p1.y, item.p2.x, item.p2.y, CONNECTION_LINE_THICKNESS, white);
+                break;
+        }
+        worldRanges.push_back({world.rangeSince(vertexStart, indexStart), item.depth});
+    }
+    shapes.write(world);
+    emitLine(debug, snapshot.groundFrom.x, snapshot.groundFrom.y, snapshot.groundTo.x, snapshot.groundTo.y,
+             snapshot.groundThickness, white);
+}
+
+RenderPipeline::RenderPipeline() {
+    for (int i = 0; i < SLOT_COUNT; ++i) {
+        states_[i] = SlotState::FREE;
+    }
+    worker_ = std::thread(&RenderPipeline::workerLoop, this);
+}
+
+RenderPipeline::~RenderPipeline() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    cv_.notify_all();
+    worker_.join();
+}
+
+RenderSnapshot& RenderPipeline::beginSnapshot() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (writing_ < 0) {
+        // With at most MAX_IN_FLIGHT published there is always a free slot
+        cv_.wait(lock, [this] {
+            for (int i = 0; i < SLOT_COUNT; ++i) {
+                if (states_[i] == SlotState::FREE) return true;
+            }
+            return false;
+        });
+        for (int i = 0; i < SLOT_COUNT; ++i) {
+            if (states_[i] == SlotState::FREE) {
+                writing_ = i;
+                break;
+            }
+        }
+        states_[writing_] = SlotState::WRITING;
+        slots_[writing_].snapshot.clear();
+    }
+    return slots_[writing_].snapshot;
+}
+
+void RenderPipeline::publishSnapshot() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (writing_ < 0) return;
+        states_[writing_] = SlotState::QUEUED;
+        order_[orderCount_++] = writing_;
+        writing_ = -1;
+    }
+    cv_.notify_all();
+}
+
+RenderPipeline::Slot* RenderPipeline::acquireBuilt() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (orderCount_ == 0) return nullptr;
+    int oldest = order_[0];
+    if (states_[oldest] != SlotState::BUILT) {
+        if (orderCount_ < MAX_IN_FLIGHT) return nullptr;
+        cv_.wait(lock, [&] { return states_[oldest] == SlotState::BUILT; });
+    }
+    states_[oldest] = SlotState::SUBMITTING;
+    for (int i = 1; i < orderCount_; ++i) {
+        order_[i - 1] = order_[i];
+    }
+    --orderCount_;
+    return &slots_[oldest];
+}
+
+void RenderPipeline::releaseBuilt(Slot* slot) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        states_[slot - slots_] = SlotState::FREE;
+    }
+    cv_.notify_all();
+}
+
+void RenderPipeline::workerLoop() {
+    for (;;) {
+        int index = -1;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            // Build in publish order, order_ holds QUEUED/BUILT slots oldest first
+            cv_.wait(lock, [&] {
+                if (quit_) return true;
+                for (int i = 0; i < orderCount_; ++i) {
+                    if (states_[order_[i]] == SlotState::QUEUED) {
+                        index = order_[i];
+                        return true;
+                    }
+                }
+                return false;
+            });
+            if (quit_) return;
+            states_[index] = SlotState::BUILDING;
+        }
+        Slot& slot = slots_[index];
+        buildSnapshotGeometry(slot.snapshot, slot.world, slot.worldRanges, slot.debug, slot.shapes);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            states_[index] = SlotState::BUILT;
+        }
+        cv_.notify_all();
+    }
+}
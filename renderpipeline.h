@@ -0,0 +1,116 @@
+#ifndef RENDER_PIPELINE_H
+#define RENDER_PIPELINE_H
+
+#include <SDL3/SDL.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "entity.h"
+#include "Renderer.h"
+#include "camera.h"
+#include "bakedcreature.h"
+
+// One thing to draw, in the order collectAllGeometry would draw it
+struct SnapshotItem {
+    enum Kind { SHAPE, NODE, LINE };
+    Kind kind;
+    Uint16 depth;        // draw list depth, per creature
+    ShapeInstance shape; // SHAPE
+    SDL_FPoint p1, p2;   // NODE at p1, LINE from p1 to p2
+};
+
+// Extra view of the same world geometry, drawn into its own part of the window
+struct RenderView {
+    SDL_Rect viewport;
+    ViewTransform view;
+};
+
+// Everything the geometry thread needs for one frame, copied out of the simulation.
+// Written by the main thread, immutable once published.
+struct RenderSnapshot {
+    std::vector<SnapshotItem> items;
+    RenderData sprites; // sprite cache quads, built on the main thread (atlas slots live there)
+    ViewTransform view;
+    std::vector<RenderView> extraViews; // minimap, editor close-up
+    SDL_FPoint groundFrom, groundTo;
+    float groundThickness;
+    Uint16 depth = 0;   // depth of the items captured next
+    // SDL_GetTicksNS of the pointer position the hands were posed for and of the event
+    // the simulation saw, 0 when the pointer didn't move
+    Uint64 pointerSampleTime = 0;
+    Uint64 pointerEventTime = 0;
+
+    void clear() {
+        items.clear();
+        sprites.clear();
+        extraViews.clear();
+        depth = 0;
+    }
+};
+
+// Geometry of one snapshot item, for the draw list sort keys
+struct SnapshotRange {
+    RenderRange range;
+    Uint16 depth;
+};
+
+// Same traversal as Renderer::collectAllGeometry / collectDynamicGeometry, but records
+// items instead of emitting triangles
+void captureAllGeometry(Entity* rootEntity, RenderSnapshot& snapshot, bool includeNodes, const SDL_FRect* cullRect);
+void captureDynamicGeometry(Entity* entity, RenderSnapshot& snapshot, bool includeNodes, const SDL_FRect* cullRect);
+// Same items from a blueprint and a pose, a loop over its parts instead of a tree
+// walk. dynamicOnly matches captureDynamicGeometry.
+void captureBlueprintGeometry(const CreatureBlueprint& blueprint, const CreaturePose* poses, RenderSnapshot& snapshot,
+                              bool includeNodes, const SDL_FRect* cullRect, bool dynamicOnly);
+// Nodes and lines are emitted in item order, shapes get their room in order and are
+// filled in per shape type at the end (shapes is scratch)
+void buildSnapshotGeometry(const RenderSnapshot& snapshot, RenderData& world, std::vector<SnapshotRange>& worldRanges,
+                           RenderData& debug, ShapeBuckets& shapes);
+
+// Three slots cycle through: the main thread fills one, the geometry thread builds
+// the previous one, and the main thread submits the one before that. Only the main
+// thread makes SDL calls.
+class RenderPipeline {
+public:
+    static constexpr int SLOT_COUNT = 3;
+    static constexpr int MAX_IN_FLIGHT = 2; // published but not yet submitted
+
+    struct Slot {
+        RenderSnapshot snapshot;
+        RenderData world;
+        std::vector<SnapshotRange> worldRanges;
+        RenderData debug;
+        ShapeBuckets shapes;
+    };
+
+    RenderPipeline();
+    ~RenderPipeline();
+    RenderPipeline(const RenderPipeline&) = delete;
+    RenderPipeline& operator=(const RenderPipeline&) = delete;
+
+    // Main thread: a free slot to capture into, then hand it to the geometry thread
+    RenderSnapshot& beginSnapshot();
+    void publishSnapshot();
+    // Main thread: oldest published slot once its geometry is built. Only blocks when
+    // MAX_IN_FLIGHT slots are in flight, otherwise returns nullptr if it isn't ready yet.
+    Slot* acquireBuilt();
+    void releaseBuilt(Slot* slot);
+
+private:
+    enum class SlotState { FREE, WRITING, QUEUED, BUILDING, BUILT, SUBMITTING };
+
+    Slot slots_[SLOT_COUNT];
+    SlotState states_[SLOT_COUNT];
+    int order_[SLOT_COUNT];  // published slots, oldest first
+    int orderCount_ = 0;
+    int writing_ = -1;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool quit_ = false;
+    std::thread worker_;
+
+    void workerLoop();
+};
+
+#endif // RENDER_PIPELINE_H
@@ -0,0 +1,71 @@
+#include "resolution.h"
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+
+void DynamicResolution::pinScale(float scale) {
+    scale_ = std::clamp(scale, MIN_SCALE, MAX_SCALE);
+    pinned_ = true;
+}
+
+bool DynamicResolution::begin(int outputW, int outputH) {
+    active_ = false;
+    if (!enabled_ || scale_ >= MAX_SCALE || outputW <= 0 || outputH <= 0) return false;
+
+    // The target stays at window size, lower scales only use its top-left part
+    if (!target_ || targetW_ != outputW || targetH_ != outputH) {
+        destroy();
+        target_ = renderer_->createTexture(SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, outputW, outputH);
+        if (!target_) {
+            printf("DynamicResolution: failed to create target: %s\n", SDL_GetError());
+            enabled_ = false;
+            return false;
+        }
+        renderer_->setTextureScaleMode(target_, SDL_SCALEMODE_LINEAR);
+        targetW_ = outputW;
+        targetH_ = outputH;
+    }
+    usedRect_ = {0.0f, 0.0f, std::ceil(outputW * scale_), std::ceil(outputH * scale_)};
+    renderer_->setRenderTarget(target_);
+    active_ = true;
+    return true;
+}
+
+void DynamicResolution::end() {
+    if (!active_) return;
+    renderer_->setRenderTarget(nullptr);
+    renderer_->renderTexture(target_, &usedRect_, nullptr);
+    active_ = false;
+}
+
+ViewTransform DynamicResolution::scaleView(const ViewTransform& view) const {
+    return {view.scale * scale_, view.offsetX * scale_, view.offsetY * scale_};
+}
+
+void DynamicResolution::reportFrameTime(float ms) {
+    averageMs_ = averageMs_ == 0.0f ? ms : averageMs_ + (ms - averageMs_) * SMOOTHING;
+    if (!enabled_ || pinned_) return;
+    if (cooldown_ > 0) {
+        --cooldown_;
+        return;
+    }
+    float newScale = scale_;
+    if (averageMs_ > targetMs_) {
+        newScale = std::max(MIN_SCALE, scale_ - SCALE_STEP);
+    } else if (averageMs_ < targetMs_ * GROW_BELOW) {
+        newScale = std::min(MAX_SCALE, scale_ + SCALE_STEP);
+    }
+    if (newScale != scale_) {
+        scale_ = newScale;
+        cooldown_ = COOLDOWN_FRAMES;
+    }
+}
+
+void DynamicResolution::destroy() {
+    if (target_) {
+        SDL_DestroyTexture(target_);
+        target_ = nullptr;
+    }
+    targetW_ = 0;
+    targetH_ = 0;
+}
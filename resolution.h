@@ -0,0 +1,60 @@
+#ifndef RESOLUTION_H
+#define RESOLUTION_H
+
+#include <SDL3/SDL.h>
+#include "Renderer.h"
+#include "camera.h"
+
+// Renders the world into part of an offscreen target and upscales it to the window
+// with linear filtering. The scale follows the measured frame time: it drops when
+// frames are over budget and only grows back when they are well under it, and
+// waits a while after every change so the average can settle (no oscillation).
+class DynamicResolution {
+public:
+    static constexpr float MIN_SCALE = 0.5f;
+    static constexpr float MAX_SCALE = 1.0f;
+    static constexpr float SCALE_STEP = 0.05f;
+    static constexpr float GROW_BELOW = 0.7f;  // Grow when the average is under 70% of the target
+    static constexpr int COOLDOWN_FRAMES = 30;  // Frames to wait after a change
+    static constexpr float SMOOTHING = 0.1f;    // Weight of the newest frame in the average
+
+    DynamicResolution(Renderer* renderer) : renderer_(renderer) {}
+
+    void setEnabled(bool enabled) { enabled_ = enabled; }
+    bool isEnabled() const { return enabled_; }
+    void setTargetFrameTime(float ms) { targetMs_ = ms; }
+    float getTargetFrameTime() const { return targetMs_; }
+    // A pinned scale is used as is, frame times are ignored until unpin()
+    void pinScale(float scale);
+    void unpin() { pinned_ = false; }
+    bool isPinned() const { return pinned_; }
+    float getScale() const { return scale_; }
+    float getAverageFrameTime() const { return averageMs_; }
+
+    // Makes the scaled target the render target. Returns false when the world should
+    // be drawn straight to the window (disabled or scale 1), end() is a no-op then.
+    bool begin(int outputW, int outputH);
+    // Back to the window, draws the used part of the target over all of it
+    void end();
+    // World view for the scaled target
+    ViewTransform scaleView(const ViewTransform& view) const;
+    // Render time of the last frame (without waiting for vsync)
+    void reportFrameTime(float ms);
+    // Must be called before the SDL renderer is destroyed
+    void destroy();
+
+private:
+    Renderer* renderer_;
+    SDL_Texture* target_ = nullptr;
+    int targetW_ = 0, targetH_ = 0;
+    SDL_FRect usedRect_ = {0.0f, 0.0f, 0.0f, 0.0f};
+    bool enabled_ = false;
+    bool active_ = false;
+    bool pinned_ = false;
+    float scale_ = 1.0f;
+    float targetMs_ = 14.0f;
+    float averageMs_ = 0.0f;
+    int cooldown_ = 0;
+};
+
+#endif // RESOLUTION_H
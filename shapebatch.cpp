@@ -0,0 +1,230 @@
+#include "shapebatch.h"
+#include "shapetraits.h"
+#include <SDL3/SDL_intrin.h>
+#include <cmath>
+#include <limits>
+
+void ShapeBatch::clear(Shape newShape) {
+    shape = newShape;
+    count = 0;
+    x.clear();
+    y.clear();
+    cosR.clear();
+    sinR.clear();
+    halfW.clear();
+    halfH.clear();
+}
+
+void ShapeBatch::add(const Entity* entity, float margin) {
+    if (count == (int)x.size()) {
+        // NaN extents fail every compare, so padding never contains a point
+        const float none = std::numeric_limits<float>::quiet_NaN();
+        size_t padded = x.size() + SIMD_WIDTH;
+        x.resize(padded, 0.0f);
+        y.resize(padded, 0.0f);
+        cosR.resize(padded, 1.0f);
+        sinR.resize(padded, 0.0f);
+        halfW.resize(padded, none);
+        halfH.resize(padded, none);
+    }
+    x[count] = entity->Xpos;
+    y[count] = entity->Ypos;
+    cosR[count] = (float)std::cos((double)entity->rotation);
+    sinR[count] = (float)std::sin((double)entity->rotation);
+    float w = entity->width / 2.0f + margin;
+    float h = entity->height / 2.0f + margin;
+    visitShape(shape, [&](auto traits) { decltype(traits)::batchExtents(w, h); });
+    halfW[count] = w;
+    halfH[count] = h;
+    ++count;
+}
+
+// The sides of Traits::EDGES from E on, each x * rx + y * ry <= limit * hw (or hh).
+// Terms with a zero factor are left out at compile time.
+template <typename Traits, int E = 0>
+static inline bool insideEdgesScalar(float rx, float ry, float hw, float hh) {
+    if constexpr (E == (int)SDL_arraysize(Traits::EDGES)) {
+        return true;
+    } else {
+        constexpr ShapeEdge edge = Traits::EDGES[E];
+        float side;
+        if constexpr (edge.x == 0.0f) {
+            side = edge.y * ry;
+        } else if constexpr (edge.y == 0.0f) {
+            side = edge.x * rx;
+        } else {
+            side = edge.x * rx + edge.y * ry;
+        }
+        return side <= edge.limit * (edge.useHeight ? hh : hw) && insideEdgesScalar<Traits, E + 1>(rx, ry, hw, hh);
+    }
+}
+
+template <typename Traits>
+static inline bool insideScalar(float dx, float dy, float c, float s, float hw, float hh) {
+    if constexpr (Traits::ROUND) {
+        return dx * dx + dy * dy <= hh;
+    } else {
+        return insideEdgesScalar<Traits>(dx * c + dy * s, dy * c - dx * s, hw, hh);
+    }
+}
+
+template <typename Traits>
+static void scalarKernel(const ShapeBatch& b, const float* px, const float* py, int pointCount, int* hits) {
+    for (int p = 0; p < pointCount; ++p) {
+        hits[p] = -1;
+        for (int i = 0; i < b.count; ++i) {
+            if (insideScalar<Traits>(px[p] - b.x[i], py[p] - b.y[i], b.cosR[i], b.sinR[i], b.halfW[i], b.halfH[i])) {
+                hits[p] = i;
+                break;
+            }
+        }
+    }
+}
+
+static inline int lowestLane(int mask) {
+    int lane = 0;
+    while (!(mask & (1 << lane))) ++lane;
+    return lane;
+}
+
+#ifdef SDL_SSE2_INTRINSICS
+template <typename Traits, int E = 0>
+static inline __m128 insideEdgesSse(__m128 rx, __m128 ry, __m128 hw, __m128 hh, __m128 inside) {
+    if constexpr (E == (int)SDL_arraysize(Traits::EDGES)) {
+        return inside;
+    } else {
+        constexpr ShapeEdge edge = Traits::EDGES[E];
+        __m128 side;
+        if constexpr (edge.x == 0.0f) {
+            side = _mm_mul_ps(_mm_set1_ps(edge.y), ry);
+        } else if constexpr (edge.y == 0.0f) {
+            side = _mm_mul_ps(_mm_set1_ps(edge.x), rx);
+        } else {
+            side = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edge.x), rx), _mm_mul_ps(_mm_set1_ps(edge.y), ry));
+        }
+        __m128 test = _mm_cmple_ps(side, _mm_mul_ps(_mm_set1_ps(edge.limit), edge.useHeight ? hh : hw));
+        if constexpr (E > 0) test = _mm_and_ps(inside, test);
+        return insideEdgesSse<Traits, E + 1>(rx, ry, hw, hh, test);
+    }
+}
+
+template <typename Traits>
+static void sseKernel(const ShapeBatch& b, const float* px, const float* py, int pointCount, int* hits) {
+    for (int p = 0; p < pointCount; ++p) {
+        const __m128 x = _mm_set1_ps(px[p]);
+        const __m128 y = _mm_set1_ps(py[p]);
+        hits[p] = -1;
+        for (int i = 0; i < b.count; i += 4) {
+            __m128 dx = _mm_sub_ps(x, _mm_loadu_ps(&b.x[i]));
+            __m128 dy = _mm_sub_ps(y, _mm_loadu_ps(&b.y[i]));
+            __m128 hw = _mm_loadu_ps(&b.halfW[i]);
+            __m128 hh = _mm_loadu_ps(&b.halfH[i]);
+            __m128 inside;
+            if constexpr (Traits::ROUND) {
+                inside = _mm_cmple_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), hh);
+            } else {
+                __m128 c = _mm_loadu_ps(&b.cosR[i]);
+                __m128 s = _mm_loadu_ps(&b.sinR[i]);
+                __m128 rx = _mm_add_ps(_mm_mul_ps(dx, c), _mm_mul_ps(dy, s));
+                __m128 ry = _mm_sub_ps(_mm_mul_ps(dy, c), _mm_mul_ps(dx, s));
+                inside = insideEdgesSse<Traits>(rx, ry, hw, hh, _mm_setzero_ps());
+            }
+            int mask = _mm_movemask_ps(inside);
+            if (mask) {
+                hits[p] = i + lowestLane(mask);
+                break;
+            }
+        }
+    }
+}
+#endif
+
+#ifdef SDL_AVX_INTRINSICS
+// Only called when SDL_HasAVX()
+template <typename Traits, int E = 0>
+SDL_TARGETING("avx") static inline __m256 insideEdgesAvx(__m256 rx, __m256 ry, __m256 hw, __m256 hh, __m256 inside) {
+    if constexpr (E == (int)SDL_arraysize(Traits::EDGES)) {
+        return inside;
+    } else {
+        constexpr ShapeEdge edge = Traits::EDGES[E];
+        __m256 side;
+        if constexpr (edge.x == 0.0f) {
+            side = _mm256_mul_ps(_mm256_set1_ps(edge.y), ry);
+        } else if constexpr (edge.y == 0.0f) {
+            side = _mm256_mul_ps(_mm256_set1_ps(edge.x), rx);
+        } else {
+            side = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(edge.x), rx), _mm256_mul_ps(_mm256_set1_ps(edge.y), ry));
+        }
+        __m256 test = _mm256_cmp_ps(side, _mm256_mul_ps(_mm256_set1_ps(edge.limit), edge.useHeight ? hh : hw), _CMP_LE_OQ);
+        if constexpr (E > 0) test = _mm256_and_ps(inside, test);
+        return insideEdgesAvx<Traits, E + 1>(rx, ry, hw, hh, test);
+    }
+}
+
+template <typename Traits>
+SDL_TARGETING("avx") static void avxKernel(const ShapeBatch& b, const float* px, const float* py, int pointCount, int* hits) {
+    for (int p = 0; p < pointCount; ++p) {
+        const __m256 x = _mm256_set1_ps(px[p]);
+        const __m256 y = _mm256_set1_ps(py[p]);
+        hits[p] = -1;
+        for (int i = 0; i < b.count; i += 8) {
+            __m256 dx = _mm256_sub_ps(x, _mm256_loadu_ps(&b.x[i]));
+            __m256 dy = _mm256_sub_ps(y, _mm256_loadu_ps(&b.y[i]));
+            __m256 hw = _mm256_loadu_ps(&b.halfW[i]);
+            __m256 hh = _mm256_loadu_ps(&b.halfH[i]);
+            __m256 inside;
+            if constexpr (Traits::ROUND) {
+                inside = _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), hh, _CMP_LE_OQ);
+            } else {
+                __m256 c = _mm256_loadu_ps(&b.cosR[i]);
+                __m256 s = _mm256_loadu_ps(&b.sinR[i]);
+                __m256 rx = _mm256_add_ps(_mm256_mul_ps(dx, c), _mm256_mul_ps(dy, s));
+                __m256 ry = _mm256_sub_ps(_mm256_mul_ps(dy, c), _mm256_mul_ps(dx, s));
+                inside = insideEdgesAvx<Traits>(rx, ry, hw, hh, _mm256_setzero_ps());
+            }
+            int mask = _mm256_movemask_ps(inside);
+            if (mask) {
+                hits[p] = i + lowestLane(mask);
+                break;
+            }
+        }
+    }
+}
+#endif
+
+typedef void (*ShapeKernel)(const ShapeBatch&, const float*, const float*, int, int*);
+
+template <typename Traits>
+static ShapeKernel selectKernel() {
+#ifdef SDL_AVX_INTRINSICS
+    if (SDL_HasAVX()) return avxKernel<Traits>;
+#endif
+#ifdef SDL_SSE2_INTRINSICS
+    return sseKernel<Traits>;
+#else
+    return scalarKernel<Traits>;
+#endif
+}
+
+void pointsInShapes(const ShapeBatch& batch, const float* px, const float* py, int pointCount, int* hits) {
+    visitShape(batch.shape, [&](auto traits) {
+        selectKernel<decltype(traits)>()(batch, px, py, pointCount, hits);
+    });
+}
+
+void pointsInShapesScalar(const ShapeBatch& batch, const float* px, const float* py, int pointCount, int* hits) {
+    visitShape(batch.shape, [&](auto traits) {
+        scalarKernel<decltype(traits)>(batch, px, py, pointCount, hits);
+    });
+}
+
+const char* getShapeBatchSimdName() {
+#ifdef SDL_AVX_INTRINSICS
+    if (SDL_HasAVX()) return "AVX";
+#endif
+#ifdef SDL_SSE2_INTRINSICS
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
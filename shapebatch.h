@@ -0,0 +1,35 @@
+#ifndef SHAPE_BATCH_H
+#define SHAPE_BATCH_H
+
+#include <SDL3/SDL.h>
+#include <vector>
+#include "entity.h"
+
+// Shapes of one type in SoA form, for testing many points against them at once.
+// Each shape keeps its center, the cosine and sine of its rotation and its half
+// extents (triangles only use halfW like ShapeTraits<TRIANGLE>, circles keep the
+// squared radius in halfH), so a test is a few multiply-adds and compares instead of
+// trig and divides. The arrays are padded to a multiple of SIMD_WIDTH with shapes that
+// contain no point.
+struct ShapeBatch {
+    static constexpr int SIMD_WIDTH = 8;
+
+    Shape shape = RECTANGLE;
+    int count = 0;
+    std::vector<float> x, y, cosR, sinR, halfW, halfH;
+
+    void clear(Shape newShape);
+    // entity's position, rotation and size as the batch's shape. margin grows it,
+    // like a pick tolerance.
+    void add(const Entity* entity, float margin = 0.0f);
+    int size() const { return count; }
+};
+
+// hits[i] = index of the first shape containing point i, -1 if none. Same answer as
+// pointInEntityShape except for rounding right on a shape's edge.
+void pointsInShapes(const ShapeBatch& batch, const float* px, const float* py, int pointCount, int* hits);
+// One point at a time, one shape at a time: the reference for the benchmark
+void pointsInShapesScalar(const ShapeBatch& batch, const float* px, const float* py, int pointCount, int* hits);
+const char* getShapeBatchSimdName();
+
+#endif // SHAPE_BATCH_H
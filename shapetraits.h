@@ -0,0 +1,254 @@
+#ifndef SHAPE_TRAITS_H
+#define SHAPE_TRAITS_H
+
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include "entity.h"
+
+// Everything that differs between the shapes, one specialization per Shape:
+//   SHAPE            the enum value
+//   NODES            where GenerateNodes puts the nodes, in node coordinates
+//   OUTLINE/INDICES  the filled shape as triangles, relative to the half extents.
+//                    ROUND shapes are a circle of CIRCLE_SIDES around the center instead.
+//   SQUARE           only the width counts, the height is ignored
+//   VERTEX_COUNT/INDEX_COUNT  geometry of one shape
+//   contains()       point test in world space
+//   clamp()          closest point of the shape in world space
+//   clampRelative()  the same in node coordinates
+//   batchExtents()   how ShapeBatch stores the half extents (ROUND: squared radius in hh)
+//   EDGES            ShapeBatch's test in the shape's own frame, all sides must hold.
+//                    ROUND shapes test the squared distance against hh instead.
+// Code that handles shapes is written once against these and instantiated per shape
+// by visitShape / forEachShape, so a new shape is an enum value and a specialization.
+template <Shape S>
+struct ShapeTraits;
+
+// cos/sin in double like the unqualified calls in entity.cpp, so every user of the
+// traits gets the same bits as the tree code always did
+struct ShapeRotation {
+    double c, s;
+    explicit ShapeRotation(float angle) : c(std::cos((double)angle)), s(std::sin((double)angle)) {}
+};
+
+// One side of a convex shape in its own frame: inside when
+// x * rx + y * ry <= limit * (useHeight ? half height : half width)
+struct ShapeEdge {
+    float x, y, limit;
+    bool useHeight;
+};
+
+template <>
+struct ShapeTraits<RECTANGLE> {
+    static constexpr Shape SHAPE = RECTANGLE;
+    static constexpr NodeRel NODES[] = {{0.0f, -1.0f}, {0.0f, 1.0f}, {-1.0f, 0.0f}, {1.0f, 0.0f}}; // top, bottom, left, right
+    static constexpr SDL_FPoint OUTLINE[] = {{-1.0f, -1.0f}, {1.0f, -1.0f}, {1.0f, 1.0f}, {-1.0f, 1.0f}};
+    static constexpr Uint16 INDICES[] = {0, 1, 2, 2, 3, 0};
+    static constexpr bool ROUND = false;
+    static constexpr bool SQUARE = false;
+    static constexpr int VERTEX_COUNT = SDL_arraysize(OUTLINE);
+    static constexpr int INDEX_COUNT = SDL_arraysize(INDICES);
+
+    static bool contains(float px, float py, const Entity* entity) {
+        ShapeRotation r(-entity->rotation);
+        float dx = px - entity->Xpos;
+        float dy = py - entity->Ypos;
+        float rx = dx * r.c - dy * r.s;
+        float ry = dx * r.s + dy * r.c;
+        float hw = entity->width / 2.0f;
+        float hh = entity->height / 2.0f;
+        return rx >= -hw && rx <= hw && ry >= -hh && ry <= hh;
+    }
+
+    static SDL_FPoint clamp(SDL_FPoint pt, const Entity* entity) {
+        float hw = entity->width / 2.0f;
+        float hh = entity->height / 2.0f;
+        float cx = entity->Xpos;
+        float cy = entity->Ypos;
+        ShapeRotation toLocal(-entity->rotation), toWorld(entity->rotation);
+        float dx = pt.x - cx;
+        float dy = pt.y - cy;
+        float rx = std::clamp((float)(dx * toLocal.c - dy * toLocal.s), -hw, hw);
+        float ry = std::clamp((float)(dx * toLocal.s + dy * toLocal.c), -hh, hh);
+        pt.x = cx + rx * toWorld.c - ry * toWorld.s;
+        pt.y = cy + rx * toWorld.s + ry * toWorld.c;
+        return pt;
+    }
+
+    static NodeRel clampRelative(NodeRel rel) {
+        rel.x_rel = std::clamp(rel.x_rel, -1.0f, 1.0f);
+        rel.y_rel = std::clamp(rel.y_rel, -1.0f, 1.0f);
+        return rel;
+    }
+
+    static constexpr ShapeEdge EDGES[] = {
+        {1.0f, 0.0f, 1.0f, false}, {-1.0f, 0.0f, 1.0f, false}, {0.0f, 1.0f, 1.0f, true}, {0.0f, -1.0f, 1.0f, true}
+    };
+    static void batchExtents(float&, float&) {}
+};
+
+template <>
+struct ShapeTraits<CIRCLE> {
+    static constexpr Shape SHAPE = CIRCLE;
+    static constexpr NodeRel NODES[] = {{0.0f, -1.0f}, {0.0f, 1.0f}, {-1.0f, 0.0f}, {1.0f, 0.0f}}; // top, bottom, left, right
+    static constexpr int CIRCLE_SIDES = 32;
+    static constexpr bool ROUND = true;
+    static constexpr bool SQUARE = true;
+    static constexpr int VERTEX_COUNT = CIRCLE_SIDES + 1;
+    static constexpr int INDEX_COUNT = 3 * CIRCLE_SIDES;
+
+    static bool contains(float px, float py, const Entity* entity) {
+        float dx = px - entity->Xpos;
+        float dy = py - entity->Ypos;
+        float r = entity->width / 2.0f;
+        return dx * dx + dy * dy <= r * r;
+    }
+
+    static SDL_FPoint clamp(SDL_FPoint pt, const Entity* entity) {
+        float r = entity->width / 2.0f;
+        float dx = pt.x - entity->Xpos;
+        float dy = pt.y - entity->Ypos;
+        float dist = std::sqrt((double)(dx * dx + dy * dy));
+        if (dist > r && dist > 0.0001f) {
+            float scale = r / dist;
+            pt.x = entity->Xpos + dx * scale;
+            pt.y = entity->Ypos + dy * scale;
+        }
+        return pt;
+    }
+
+    static NodeRel clampRelative(NodeRel rel) {
+        rel = ShapeTraits<RECTANGLE>::clampRelative(rel);
+        float dist = std::sqrt((double)(rel.x_rel * rel.x_rel + rel.y_rel * rel.y_rel));
+        if (dist > 1.0f && dist > 0.0001f) {
+            float scale = 1.0f / dist;
+            rel.x_rel *= scale;
+            rel.y_rel *= scale;
+        }
+        return rel;
+    }
+
+    static void batchExtents(float& hw, float& hh) {
+        hh = hw * hw; // compared with the squared distance
+    }
+};
+
+// Pointing up, the bottom corners at (-s, s) and (s, s) with s = width / 2
+template <>
+struct ShapeTraits<TRIANGLE> {
+    static constexpr Shape SHAPE = TRIANGLE;
+    static constexpr NodeRel NODES[] = {{0.0f, -1.0f}, {-1.0f, 1.0f}, {1.0f, 1.0f}}; // top, bottom left, bottom right
+    static constexpr SDL_FPoint OUTLINE[] = {{0.0f, -1.0f}, {-1.0f, 1.0f}, {1.0f, 1.0f}};
+    static constexpr Uint16 INDICES[] = {0, 1, 2};
+    static constexpr bool ROUND = false;
+    static constexpr bool SQUARE = true;
+    static constexpr int VERTEX_COUNT = SDL_arraysize(OUTLINE);
+    static constexpr int INDEX_COUNT = SDL_arraysize(INDICES);
+
+    // Barycentric coordinates of the rotated corners, with a little tolerance
+    static bool contains(float px, float py, const Entity* entity) {
+        float s = entity->width / 2.0f;
+        float cx = entity->Xpos;
+        float cy = entity->Ypos;
+        ShapeRotation r(entity->rotation);
+        SDL_FPoint p[3];
+        for (int i = 0; i < 3; ++i) {
+            float x = OUTLINE[i].x * s;
+            float y = OUTLINE[i].y * s;
+            p[i].x = cx + (x * r.c - y * r.s);
+            p[i].y = cy + (x * r.s + y * r.c);
+        }
+        float denom = (p[1].y - p[2].y) * (p[0].x - p[2].x) + (p[2].x - p[1].x) * (p[0].y - p[2].y);
+        if (std::fabs(denom) < 0.0001f) { // Relaxed tolerance, near-degenerate triangle
+            return false;
+        }
+        float a = ((p[1].y - p[2].y) * (px - p[2].x) + (p[2].x - p[1].x) * (py - p[2].y)) / denom;
+        float b = ((p[2].y - p[0].y) * (px - p[2].x) + (p[0].x - p[2].x) * (py - p[2].y)) / denom;
+        float c = 1.0f - a - b;
+        return a >= -0.01f && b >= -0.01f && c >= -0.01f && (a + b + c) <= 1.01f; // Relaxed bounds
+    }
+
+    static SDL_FPoint clamp(SDL_FPoint pt, const Entity* entity) {
+        float s = entity->width / 2.0f;
+        float cx = entity->Xpos;
+        float cy = entity->Ypos;
+        ShapeRotation toLocal(-entity->rotation), toWorld(entity->rotation);
+        float dx = pt.x - cx;
+        float dy = pt.y - cy;
+        float rx = dx * toLocal.c - dy * toLocal.s;
+        float ry = dx * toLocal.s + dy * toLocal.c;
+        SDL_FPoint p1 = {0.0f, -s};
+        SDL_FPoint p2 = {-s, s};
+        SDL_FPoint p3 = {s, s};
+        float denom = (p2.y - p3.y) * (p1.x - p3.x) + (p3.x - p2.x) * (p1.y - p3.y);
+        if (std::fabs(denom) < 0.0001f) {
+            return pt; // Degenerate triangle
+        }
+        float a = ((p2.y - p3.y) * (rx - p3.x) + (p3.x - p2.x) * (ry - p3.y)) / denom;
+        float b = ((p3.y - p1.y) * (rx - p3.x) + (p1.x - p3.x) * (ry - p3.y)) / denom;
+        float c = 1.0f - a - b;
+        normalizeClamped(a, b, c);
+        rx = a * p1.x + b * p2.x + c * p3.x;
+        ry = a * p1.y + b * p2.y + c * p3.y;
+        pt.x = cx + rx * toWorld.c - ry * toWorld.s;
+        pt.y = cy + rx * toWorld.s + ry * toWorld.c;
+        return pt;
+    }
+
+    static NodeRel clampRelative(NodeRel rel) {
+        float a = -rel.y_rel;
+        float b = (rel.x_rel + rel.y_rel) / 2.0f;
+        float c = 1.0f - a - b;
+        normalizeClamped(a, b, c);
+        rel.x_rel = -b + c;
+        rel.y_rel = -a + b + c;
+        return rel;
+    }
+
+    // contains() accepts barycentric coordinates down to -0.01, in the triangle's own frame:
+    //   a >= -0.01:  ry <= 1.02 s
+    //   b >= -0.01:  2 rx - ry <= 1.04 s
+    //   c >= -0.01: -2 rx - ry <= 1.04 s
+    static constexpr ShapeEdge EDGES[] = {
+        {0.0f, 1.0f, 1.02f, false}, {2.0f, -1.0f, 1.04f, false}, {-2.0f, -1.0f, 1.04f, false}
+    };
+    static void batchExtents(float& hw, float&) {
+        if (4.0f * hw * hw < 0.0001f) {
+            hw = std::numeric_limits<float>::quiet_NaN(); // degenerate, contains() rejects it
+        }
+    }
+
+    static void normalizeClamped(float& a, float& b, float& c) {
+        a = std::clamp(a, 0.0f, 1.0f);
+        b = std::clamp(b, 0.0f, 1.0f);
+        c = std::clamp(c, 0.0f, 1.0f);
+        float sum = a + b + c;
+        if (sum > 0.0001f) {
+            a /= sum;
+            b /= sum;
+            c /= sum;
+        }
+    }
+};
+
+// f(ShapeTraits<shape>{}), one instantiation of f per shape
+template <int S = 0, typename F>
+inline auto visitShape(Shape shape, F&& f) {
+    if constexpr (S + 1 < SHAPE_COUNT) {
+        if (shape != (Shape)S) return visitShape<S + 1>(shape, std::forward<F>(f));
+    }
+    return f(ShapeTraits<(Shape)S>{});
+}
+
+// f(ShapeTraits<S>{}) for every shape in enum order
+template <int S = 0, typename F>
+inline void forEachShape(F&& f) {
+    if constexpr (S < SHAPE_COUNT) {
+        f(ShapeTraits<(Shape)S>{});
+        forEachShape<S + 1>(std::forward<F>(f));
+    }
+}
+
+#endif // SHAPE_TRAITS_H
@@ -0,0 +1,397 @@
+#include "softraster.h"
+#include <SDL3/SDL_intrin.h>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+
+static inline Uint32 packColor(const SDL_FColor& c) {
+    Uint32 r = (Uint32)(std::clamp(c.r, 0.0f, 1.0f) * 255.0f + 0.5f);
+    Uint32 g = (Uint32)(std::clamp(c.g, 0.0f, 1.0f) * 255.0f + 0.5f);
+    Uint32 b = (Uint32)(std::clamp(c.b, 0.0f, 1.0f) * 255.0f + 0.5f);
+    return 0xFF000000u | (r << 16) | (g << 8) | b;
+}
+
+// Source-over blend into an opaque ARGB8888 pixel
+static inline Uint32 blendPixel(Uint32 dst, float r, float g, float b, float a) {
+    float dr = (float)((dst >> 16) & 0xFF);
+    float dg = (float)((dst >> 8) & 0xFF);
+    float db = (float)(dst & 0xFF);
+    Uint32 outR = (Uint32)(dr + (r * 255.0f - dr) * a + 0.5f);
+    Uint32 outG = (Uint32)(dg + (g * 255.0f - dg) * a + 0.5f);
+    Uint32 outB = (Uint32)(db + (b * 255.0f - db) * a + 0.5f);
+    return 0xFF000000u | (std::min(outR, 255u) << 16) | (std::min(outG, 255u) << 8) | std::min(outB, 255u);
+}
+
+static inline bool insideEdge(float e, bool topLeft) {
+    return e > 0.0f || (e == 0.0f && topLeft);
+}
+
+SoftRasterizer::SoftRasterizer(int numThreads) {
+    if (numThreads <= 0) {
+        numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+#ifdef SDL_AVX_INTRINSICS
+    useAvx_ = SDL_HasAVX();
+#endif
+    // The thread calling finish() rasterizes too
+    for (int i = 1; i < numThreads; ++i) {
+        workers_.emplace_back(&SoftRasterizer::workerLoop, this);
+    }
+}
+
+SoftRasterizer::~SoftRasterizer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    workCv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+const char* SoftRasterizer::getSimdName() const {
+    if (useAvx_) return "AVX";
+#ifdef SDL_SSE2_INTRINSICS
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+void SoftRasterizer::resize(int w, int h) {
+    if (w == width_ && h == height_) return;
+    width_ = std::max(w, 0);
+    height_ = std::max(h, 0);
+    tilesX_ = (width_ + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY_ = (height_ + TILE_SIZE - 1) / TILE_SIZE;
+    pixels_.assign((size_t)width_ * height_, clearColor_);
+    viewport_ = {0, 0, width_, height_};
+    triangles_.clear();
+    bins_.assign(tilesX_ * tilesY_, {});
+}
+
+void SoftRasterizer::clear(SDL_Color color) {
+    // Anything drawn before the clear is discarded, the clear itself is done per tile
+    triangles_.clear();
+    for (auto& bin : bins_) {
+        bin.clear();
+    }
+    clearColor_ = 0xFF000000u | ((Uint32)color.r << 16) | ((Uint32)color.g << 8) | color.b;
+    clearPending_ = true;
+}
+
+void SoftRasterizer::setViewport(const SDL_Rect* rect) {
+    SDL_Rect full = {0, 0, width_, height_};
+    viewport_ = full;
+    viewOriginX_ = viewOriginY_ = 0;
+    if (rect) {
+        // Geometry is relative to the viewport's corner, also where that is clipped
+        viewOriginX_ = rect->x;
+        viewOriginY_ = rect->y;
+        if (!SDL_GetRectIntersection(rect, &full, &viewport_)) {
+            viewport_ = {0, 0, 0, 0};
+        }
+    }
+}
+
+void SoftRasterizer::draw(const RenderData& data, const ViewTransform* view) {
+    for (int chunk = 0; chunk < data.chunkCount(); ++chunk) {
+        drawRange(data, chunk, data.chunks[chunk].firstIndex, data.chunkIndexCount(chunk), view);
+    }
+}
+
+void SoftRasterizer::drawRange(const RenderData& data, int chunk, int firstIndex, int numIndices, const ViewTransform* view) {
+    float scale = view ? view->scale : 1.0f;
+    float offsetX = (view ? view->offsetX : 0.0f) + viewOriginX_;
+    float offsetY = (view ? view->offsetY : 0.0f) + viewOriginY_;
+    auto place = [&](int vertex) {
+        const SDL_FPoint& p = data.positions[vertex];
+        return SDL_FPoint{p.x * scale + offsetX, p.y * scale + offsetY};
+    };
+    int firstVertex = data.chunks[chunk].firstVertex;
+    for (int i = 0; i + 2 < numIndices; i += 3) {
+        int v0 = firstVertex + data.indices[firstIndex + i];
+        int v1 = firstVertex + data.indices[firstIndex + i + 1];
+        int v2 = firstVertex + data.indices[firstIndex + i + 2];
+        addTriangle(place(v0), place(v1), place(v2), data.colors[v0], data.colors[v1], data.colors[v2]);
+    }
+}
+
+void SoftRasterizer::addTriangle(SDL_FPoint p0, SDL_FPoint p1, SDL_FPoint p2,
+                                 const SDL_FColor& c0, const SDL_FColor& c1, const SDL_FColor& c2) {
+    // Pixel centers at +0.5, a pixel is covered when its center is inside
+    float minXf = std::min({p0.x, p1.x, p2.x});
+    float maxXf = std::max({p0.x, p1.x, p2.x});
+    float minYf = std::min({p0.y, p1.y, p2.y});
+    float maxYf = std::max({p0.y, p1.y, p2.y});
+    int minX = std::max(viewport_.x, (int)std::floor(minXf - 0.5f));
+    int minY = std::max(viewport_.y, (int)std::floor(minYf - 0.5f));
+    int maxX = std::min(viewport_.x + viewport_.w - 1, (int)std::ceil(maxXf - 0.5f));
+    int maxY = std::min(viewport_.y + viewport_.h - 1, (int)std::ceil(maxYf - 0.5f));
+    if (minX > maxX || minY > maxY) return;
+
+    Triangle tri;
+    const SDL_FPoint p[3] = {p0, p1, p2};
+    for (int i = 0; i < 3; ++i) {
+        // Edge opposite vertex i, so its value at vertex i is twice the area
+        const SDL_FPoint& from = p[(i + 1) % 3];
+        const SDL_FPoint& to = p[(i + 2) % 3];
+        tri.a[i] = from.y - to.y;
+        tri.b[i] = to.x - from.x;
+        tri.c[i] = from.x * to.y - from.y * to.x;
+    }
+    float area2 = tri.a[0] * p0.x + tri.b[0] * p0.y + tri.c[0];
+    if (std::fabs(area2) < 1e-6f) return;
+    if (area2 < 0.0f) {
+        // SDL draws both windings, flip so the inside is always positive
+        for (int i = 0; i < 3; ++i) {
+            tri.a[i] = -tri.a[i];
+            tri.b[i] = -tri.b[i];
+            tri.c[i] = -tri.c[i];
+        }
+        area2 = -area2;
+    }
+    for (int i = 0; i < 3; ++i) {
+        tri.topLeft[i] = tri.a[i] > 0.0f || (tri.a[i] == 0.0f && tri.b[i] > 0.0f);
+    }
+    tri.invArea = 1.0f / area2;
+    tri.colors[0] = c0;
+    tri.colors[1] = c1;
+    tri.colors[2] = c2;
+    tri.flat = c0.r == c1.r && c0.g == c1.g && c0.b == c1.b && c0.a == c1.a &&
+               c0.r == c2.r && c0.g == c2.g && c0.b == c2.b && c0.a == c2.a;
+    tri.packed = packColor(c0);
+    tri.minX = minX;
+    tri.minY = minY;
+    tri.maxX = maxX;
+    tri.maxY = maxY;
+
+    int index = (int)triangles_.size();
+    triangles_.push_back(tri);
+    for (int ty = minY / TILE_SIZE; ty <= maxY / TILE_SIZE; ++ty) {
+        for (int tx = minX / TILE_SIZE; tx <= maxX / TILE_SIZE; ++tx) {
+            bins_[ty * tilesX_ + tx].push_back(index);
+        }
+    }
+}
+
+void SoftRasterizer::finish() {
+    if (triangles_.empty() && !clearPending_) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        nextTile_ = 0;
+        busyWorkers_ = (int)workers_.size();
+        ++generation_;
+    }
+    workCv_.notify_all();
+    rasterizeTiles();
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        doneCv_.wait(lock, [this] { return busyWorkers_ == 0; });
+    }
+    triangles_.clear();
+    for (auto& bin : bins_) {
+        bin.clear();
+    }
+    clearPending_ = false;
+}
+
+void SoftRasterizer::workerLoop() {
+    int seenGeneration = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            workCv_.wait(lock, [&] { return quit_ || generation_ != seenGeneration; });
+            if (quit_) return;
+            seenGeneration = generation_;
+        }
+        rasterizeTiles();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--busyWorkers_ == 0) doneCv_.notify_one();
+        }
+    }
+}
+
+void SoftRasterizer::rasterizeTiles() {
+    int tileCount = tilesX_ * tilesY_;
+    for (int tile = nextTile_++; tile < tileCount; tile = nextTile_++) {
+        rasterizeTile(tile);
+    }
+}
+
+void SoftRasterizer::rasterizeTile(int tile) {
+    int x0 = (tile % tilesX_) * TILE_SIZE;
+    int y0 = (tile / tilesX_) * TILE_SIZE;
+    int x1 = std::min(x0 + TILE_SIZE, width_) - 1;
+    int y1 = std::min(y0 + TILE_SIZE, height_) - 1;
+
+    if (clearPending_) {
+        for (int y = y0; y <= y1; ++y) {
+            std::fill_n(&pixels_[(size_t)y * width_ + x0], x1 - x0 + 1, clearColor_);
+        }
+    }
+    for (int index : bins_[tile]) {
+        const Triangle& tri = triangles_[index];
+        int rx0 = std::max(x0, tri.minX);
+        int rx1 = std::min(x1, tri.maxX);
+        int ry0 = std::max(y0, tri.minY);
+        int ry1 = std::min(y1, tri.maxY);
+        for (int y = ry0; y <= ry1; ++y) {
+            rasterizeRow(tri, y, rx0, rx1);
+        }
+    }
+}
+
+void SoftRasterizer::shadePixel(const Triangle& tri, Uint32* pixel, float e0, float e1, float e2) {
+    if (tri.flat) {
+        const SDL_FColor& c = tri.colors[0];
+        *pixel = c.a >= 1.0f ? tri.packed : blendPixel(*pixel, c.r, c.g, c.b, c.a);
+        return;
+    }
+    float l0 = e0 * tri.invArea;
+    float l1 = e1 * tri.invArea;
+    float l2 = e2 * tri.invArea;
+    const SDL_FColor* c = tri.colors;
+    *pixel = blendPixel(*pixel,
+                        c[0].r * l0 + c[1].r * l1 + c[2].r * l2,
+                        c[0].g * l0 + c[1].g * l1 + c[2].g * l2,
+                        c[0].b * l0 + c[1].b * l1 + c[2].b * l2,
+                        c[0].a * l0 + c[1].a * l1 + c[2].a * l2);
+}
+
+#ifdef SDL_AVX_INTRINSICS
+// 8 pixels per step, only called when SDL_HasAVX(). Returns the first x it did not handle.
+SDL_TARGETING("avx") static int rowAvx(const float a[3], const bool topLeft[3], const float e[3],
+                                       Uint32* row, int x, int x1, bool opaqueFlat, Uint32 packed,
+                                       int* masks, int* starts, int& groups) {
+    const __m256 laneOffsets = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256 zero = _mm256_setzero_ps();
+    __m256 edge[3], step[3];
+    for (int i = 0; i < 3; ++i) {
+        edge[i] = _mm256_add_ps(_mm256_set1_ps(e[i]), _mm256_mul_ps(_mm256_set1_ps(a[i]), laneOffsets));
+        step[i] = _mm256_set1_ps(a[i] * 8.0f);
+    }
+    const __m256 color = _mm256_castsi256_ps(_mm256_set1_epi32((int)packed));
+    int start = x;
+    for (; x + 7 <= x1; x += 8) {
+        __m256 inside = _mm256_set1_ps(-1.0f);
+        for (int i = 0; i < 3; ++i) {
+            __m256 m = topLeft[i] ? _mm256_cmp_ps(edge[i], zero, _CMP_GE_OQ) : _mm256_cmp_ps(edge[i], zero, _CMP_GT_OQ);
+            inside = _mm256_and_ps(inside, m);
+            edge[i] = _mm256_add_ps(edge[i], step[i]);
+        }
+        int mask = _mm256_movemask_ps(inside);
+        if (mask == 0) continue;
+        if (opaqueFlat) {
+            float* dst = reinterpret_cast<float*>(row + x);
+            _mm256_storeu_ps(dst, _mm256_blendv_ps(_mm256_loadu_ps(dst), color, inside));
+        } else {
+            masks[groups] = mask;
+            starts[groups] = x - start;
+            ++groups;
+        }
+    }
+    return x;
+}
+#endif
+
+void SoftRasterizer::rasterizeRow(const Triangle& tri, int y, int x0, int x1) {
+    Uint32* row = &pixels_[(size_t)y * width_];
+    float py = y + 0.5f;
+    float e[3];
+    for (int i = 0; i < 3; ++i) {
+        e[i] = tri.a[i] * (x0 + 0.5f) + tri.b[i] * py + tri.c[i];
+    }
+    bool opaqueFlat = tri.flat && tri.colors[0].a >= 1.0f;
+    int x = x0;
+
+    // Groups never reach past x1, so a thread only ever touches its own tile
+#ifdef SDL_AVX_INTRINSICS
+    if (useAvx_) {
+        int masks[TILE_SIZE / 8];
+        int starts[TILE_SIZE / 8];
+        int groups = 0;
+        x = rowAvx(tri.a, tri.topLeft, e, row, x0, x1, opaqueFlat, tri.packed, masks, starts, groups);
+        for (int g = 0; g < groups; ++g) {
+            for (int lane = 0; lane < 8; ++lane) {
+                if (!(masks[g] & (1 << lane))) continue;
+                float dx = (float)(starts[g] + lane);
+                shadePixel(tri, row + x0 + starts[g] + lane,
+                           e[0] + tri.a[0] * dx, e[1] + tri.a[1] * dx, e[2] + tri.a[2] * dx);
+            }
+        }
+    }
+#endif
+#ifdef SDL_SSE2_INTRINSICS
+    {
+        const __m128 laneOffsets = _mm_setr_ps(0, 1, 2, 3);
+        const __m128 zero = _mm_setzero_ps();
+        __m128 edge[3], step[3];
+        for (int i = 0; i < 3; ++i) {
+            float start = e[i] + tri.a[i] * (x - x0);
+            edge[i] = _mm_add_ps(_mm_set1_ps(start), _mm_mul_ps(_mm_set1_ps(tri.a[i]), laneOffsets));
+            step[i] = _mm_set1_ps(tri.a[i] * 4.0f);
+        }
+        const __m128i color = _mm_set1_epi32((int)tri.packed);
+        for (; x + 3 <= x1; x += 4) {
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (int i = 0; i < 3; ++i) {
+                __m128 m = tri.topLeft[i] ? _mm_cmpge_ps(edge[i], zero) : _mm_cmpgt_ps(edge[i], zero);
+                inside = _mm_and_ps(inside, m);
+                edge[i] = _mm_add_ps(edge[i], step[i]);
+            }
+            int mask = _mm_movemask_ps(inside);
+            if (mask == 0) continue;
+            if (opaqueFlat) {
+                __m128i* dst = reinterpret_cast<__m128i*>(row + x);
+                __m128i m = _mm_castps_si128(inside);
+                __m128i old = _mm_loadu_si128(dst);
+                _mm_storeu_si128(dst, _mm_or_si128(_mm_and_si128(m, color), _mm_andnot_si128(m, old)));
+            } else {
+                for (int lane = 0; lane < 4; ++lane) {
+                    if (!(mask & (1 << lane))) continue;
+                    float dx = (float)(x + lane - x0);
+                    shadePixel(tri, row + x + lane, e[0] + tri.a[0] * dx, e[1] + tri.a[1] * dx, e[2] + tri.a[2] * dx);
+                }
+            }
+        }
+    }
+#endif
+    // Scalar tail (or the whole row without SIMD)
+    for (; x <= x1; ++x) {
+        float dx = (float)(x - x0);
+        float e0 = e[0] + tri.a[0] * dx;
+        float e1 = e[1] + tri.a[1] * dx;
+        float e2 = e[2] + tri.a[2] * dx;
+        if (insideEdge(e0, tri.topLeft[0]) && insideEdge(e1, tri.topLeft[1]) && insideEdge(e2, tri.topLeft[2])) {
+            shadePixel(tri, row + x, e0, e1, e2);
+        }
+    }
+}
+
+bool SoftRasterizer::present(SDL_Renderer* renderer) {
+    finish();
+    if (width_ == 0 || height_ == 0) return false;
+    if (!texture_ || textureW_ != width_ || textureH_ != height_) {
+        destroyTexture();
+        texture_ = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width_, height_);
+        if (!texture_) {
+            printf("SoftRasterizer: failed to create texture: %s\n", SDL_GetError());
+            return false;
+        }
+        textureW_ = width_;
+        textureH_ = height_;
+    }
+    SDL_UpdateTexture(texture_, nullptr, pixels_.data(), getPitch());
+    SDL_RenderTexture(renderer, texture_, nullptr, nullptr);
+    return true;
+}
+
+void SoftRasterizer::destroyTexture() {
+    if (texture_) {
+        SDL_DestroyTexture(texture_);
+        texture_ = nullptr;
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef SOFT_RASTER_H
+#define SOFT_RASTER_H
+
+#include <SDL3/SDL.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "Renderer.h"
+
+// CPU rasterizer for the untextured triangles we emit, for machines without a GPU.
+// draw() bins triangles into TILE_SIZE tiles, finish() rasterizes the tiles in
+// parallel (each tile draws its triangles in submission order, so blending matches
+// SDL). Edge functions are evaluated 8 (AVX) or 4 (SSE2) pixels at a time when
+// available. Output is an ARGB8888 buffer that present() uploads to a streaming texture.
+class SoftRasterizer {
+public:
+    static constexpr int TILE_SIZE = 64;
+
+    // numThreads = 0 uses one worker per logical core (the calling thread included)
+    SoftRasterizer(int numThreads = 0);
+    ~SoftRasterizer();
+    SoftRasterizer(const SoftRasterizer&) = delete;
+    SoftRasterizer& operator=(const SoftRasterizer&) = delete;
+
+    void resize(int w, int h);
+    void clear(SDL_Color color);
+    // Like SDL_SetRenderViewport: offsets and clips what is drawn after it, null resets
+    void setViewport(const SDL_Rect* rect);
+    // Textured geometry is not supported, callers should skip it
+    void draw(const RenderData& data, const ViewTransform* view = nullptr);
+    // Indices [firstIndex, firstIndex + numIndices) of one chunk
+    void drawRange(const RenderData& data, int chunk, int firstIndex, int numIndices, const ViewTransform* view = nullptr);
+    // Rasterizes everything drawn since the last finish()
+    void finish();
+    // finish() + copy into the streaming texture + draw it over the whole target
+    bool present(SDL_Renderer* renderer);
+    // Must be called before the SDL renderer is destroyed
+    void destroyTexture();
+
+    const Uint32* getPixels() const { return pixels_.data(); }
+    int getWidth() const { return width_; }
+    int getHeight() const { return height_; }
+    int getPitch() const { return width_ * (int)sizeof(Uint32); }
+    int getThreadCount() const { return (int)workers_.size() + 1; }
+    int getTriangleCount() const { return (int)triangles_.size(); }
+    const char* getSimdName() const;
+
+private:
+    struct Triangle {
+        float a[3], b[3], c[3]; // edge i: a*x + b*y + c >= 0 on the inside
+        bool topLeft[3];        // pixels exactly on a top/left edge belong to this triangle
+        float invArea;
+        SDL_FColor colors[3];
+        bool flat;              // all vertices share one color
+        Uint32 packed;          // flat color as ARGB8888, used when flat and opaque
+        int minX, minY, maxX, maxY;
+    };
+
+    int width_ = 0, height_ = 0;
+    int tilesX_ = 0, tilesY_ = 0;
+    SDL_Rect viewport_ = {0, 0, 0, 0}; // clip rect, the window in pixels without a viewport
+    int viewOriginX_ = 0, viewOriginY_ = 0;
+    std::vector<Uint32> pixels_;
+    std::vector<Triangle> triangles_;
+    std::vector<std::vector<int>> bins_; // triangle indices per tile
+    bool clearPending_ = false;
+    Uint32 clearColor_ = 0xFF000000;
+    bool useAvx_ = false;
+    SDL_Texture* texture_ = nullptr;
+    int textureW_ = 0, textureH_ = 0;
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable workCv_;
+    std::condition_variable doneCv_;
+    int generation_ = 0;
+    int busyWorkers_ = 0;
+    bool quit_ = false;
+    std::atomic<int> nextTile_{0};
+
+    void addTriangle(SDL_FPoint p0, SDL_FPoint p1, SDL_FPoint p2,
+                     const SDL_FColor& c0, const SDL_FColor& c1, const SDL_FColor& c2);
+    void workerLoop();
+    void rasterizeTiles();
+    void rasterizeTile(int tile);
+    void rasterizeRow(const Triangle& tri, int y, int x0, int x1);
+    void shadePixel(const Triangle& tri, Uint32* pixel, float e0, float e1, float e2);
+};
+
+#endif // SOFT_RASTER_H
@@ -0,0 +1,174 @@
+#include "spritecache.h"
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+
+static bool isStaticSubtreeDirty(Entity* entity) {
+    if (entity->spriteDirty) return true;
+    for (auto& app : entity->appendages) {
+        if (!app->isHandOrFoot && isStaticSubtreeDirty(app.get())) return true;
+    }
+    return false;
+}
+
+static void clearStaticSubtreeDirty(Entity* entity) {
+    entity->spriteDirty = false;
+    for (auto& app : entity->appendages) {
+        if (!app->isHandOrFoot) clearStaticSubtreeDirty(app.get());
+    }
+}
+
+// Largest distance from the root center that the static geometry reaches
+static float staticExtent(Entity* entity, float cx, float cy) {
+    float dx = entity->Xpos - cx;
+    float dy = entity->Ypos - cy;
+    float halfDiag = 0.5f * std::sqrt(2.0f) * std::max(entity->width, entity->height);
+    float extent = std::sqrt(dx * dx + dy * dy) + halfDiag;
+    for (int i = 0; i < entity->nodeCount; ++i) {
+        float nx = entity->nodes[i].x - cx;
+        float ny = entity->nodes[i].y - cy;
+        extent = std::max(extent, std::sqrt(nx * nx + ny * ny) + 3.0f); // node marker radius
+    }
+    for (auto& app : entity->appendages) {
+        if (!app->isHandOrFoot) extent = std::max(extent, staticExtent(app.get(), cx, cy));
+    }
+    return extent;
+}
+
+bool SpriteCache::createAtlas() {
+    atlas_ = renderer_->createTexture(SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, ATLAS_SIZE, ATLAS_SIZE);
+    if (!atlas_) {
+        printf("SpriteCache: failed to create atlas: %s\n", SDL_GetError());
+        return false;
+    }
+    renderer_->setTextureBlendMode(atlas_, SDL_BLENDMODE_BLEND);
+    renderer_->setTextureScaleMode(atlas_, SDL_SCALEMODE_LINEAR);
+    renderer_->setRenderTarget(atlas_);
+    renderer_->clear({0, 0, 0, 0});
+    renderer_->setRenderTarget(nullptr);
+    return true;
+}
+
+bool SpriteCache::allocate(int w, int h, SDL_FRect& out) {
+    if (w > ATLAS_SIZE || h > ATLAS_SIZE) return false;
+    if (shelfX_ + w > ATLAS_SIZE) {
+        shelfY_ += shelfHeight_;
+        shelfX_ = 0;
+        shelfHeight_ = 0;
+    }
+    if (shelfY_ + h > ATLAS_SIZE) return false;
+    out = {(float)shelfX_, (float)shelfY_, (float)w, (float)h};
+    shelfX_ += w;
+    shelfHeight_ = std::max(shelfHeight_, h);
+    return true;
+}
+
+// Forget every slot, cached creatures re-bake lazily the next time they are drawn
+void SpriteCache::reset() {
+    slots_.clear();
+    shelfX_ = 0;
+    shelfY_ = 0;
+    shelfHeight_ = 0;
+}
+
+bool SpriteCache::needsBake(Entity* root) const {
+    return !atlas_ || slots_.find(root) == slots_.end() || root->texture != atlas_ || isStaticSubtreeDirty(root);
+}
+
+bool SpriteCache::bake(Entity* root) {
+    auto it = slots_.find(root);
+    if (it != slots_.end() && root->texture == atlas_ && !isStaticSubtreeDirty(root)) {
+        return true;
+    }
+    if (!atlas_ && !createAtlas()) return false;
+
+    float extent = staticExtent(root, root->Xpos, root->Ypos);
+    int size = (int)std::ceil(2.0f * extent) + 2 * PADDING;
+
+    // Reuse the old slot when the creature still fits, otherwise pack a new one
+    SDL_FRect slot;
+    if (it != slots_.end() && it->second.w >= size) {
+        slot = it->second;
+    } else if (!allocate(size, size, slot)) {
+        printf("SpriteCache: atlas full, evicting all sprites\n");
+        reset();
+        if (!allocate(size, size, slot)) {
+            printf("SpriteCache: creature too large to cache (%dx%d)\n", size, size);
+            return false;
+        }
+    }
+    slots_[root] = slot;
+
+    // Collect in world space, then move into the slot with the root's rotation undone
+    bakeData_.clear();
+    renderer_->collectStaticGeometry(root, bakeData_);
+    float c = std::cos(-root->rotation);
+    float s = std::sin(-root->rotation);
+    float slotCx = slot.x + slot.w / 2.0f;
+    float slotCy = slot.y + slot.h / 2.0f;
+    for (auto& p : bakeData_.positions) {
+        float dx = p.x - root->Xpos;
+        float dy = p.y - root->Ypos;
+        p.x = slotCx + dx * c - dy * s;
+        p.y = slotCy + dx * s + dy * c;
+    }
+
+    renderer_->setRenderTarget(atlas_);
+    renderer_->setDrawColor({0, 0, 0, 0});
+    renderer_->fillRect(&slot);
+    renderer_->renderBatchedGeometry(bakeData_);
+    renderer_->setRenderTarget(nullptr);
+
+    if (root->texture && !root->sharedTexture) {
+        SDL_DestroyTexture(root->texture);
+    }
+    root->texture = atlas_;
+    root->sharedTexture = true;
+    root->textureRect = slot;
+    clearStaticSubtreeDirty(root);
+    return true;
+}
+
+void SpriteCache::collectSprite(Entity* root, RenderData& data) const {
+    auto it = slots_.find(root);
+    if (it == slots_.end()) return;
+    const SDL_FRect& slot = it->second;
+
+    float hw = slot.w / 2.0f;
+    float hh = slot.h / 2.0f;
+    float c = std::cos(root->rotation);
+    float s = std::sin(root->rotation);
+    SDL_FPoint corners[4] = {{-hw, -hh}, {hw, -hh}, {hw, hh}, {-hw, hh}};
+    float u0 = slot.x / ATLAS_SIZE;
+    float v0 = slot.y / ATLAS_SIZE;
+    float u1 = (slot.x + slot.w) / ATLAS_SIZE;
+    float v1 = (slot.y + slot.h) / ATLAS_SIZE;
+    SDL_FPoint uvs[4] = {{u0, v0}, {u1, v0}, {u1, v1}, {u0, v1}};
+
+    Uint16 baseIndex = data.beginShape(4);
+    for (int i = 0; i < 4; ++i) {
+        float x = root->Xpos + corners[i].x * c - corners[i].y * s;
+        float y = root->Ypos + corners[i].x * s + corners[i].y * c;
+        data.addVertex(x, y, {1.0f, 1.0f, 1.0f, 1.0f}, uvs[i]);
+    }
+    data.indices.insert(data.indices.end(), {baseIndex, (Uint16)(baseIndex + 1), (Uint16)(baseIndex + 2),
+                                             (Uint16)(baseIndex + 2), (Uint16)(baseIndex + 3), baseIndex});
+}
+
+void SpriteCache::release(Entity* root) {
+    slots_.erase(root);
+    if (root->sharedTexture) {
+        root->texture = nullptr;
+        root->sharedTexture = false;
+        root->textureRect = {0.0f, 0.0f, 0.0f, 0.0f};
+    }
+    root->spriteDirty = true;
+}
+
+void SpriteCache::clear() {
+    reset();
+    if (atlas_) {
+        SDL_DestroyTexture(atlas_);
+        atlas_ = nullptr;
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef SPRITE_CACHE_H
+#define SPRITE_CACHE_H
+
+#include <SDL3/SDL.h>
+#include <unordered_map>
+#include "entity.h"
+#include "Renderer.h"
+
+// Bakes the static part of a creature (everything except hands/feet) into a slot of
+// one shared atlas texture, so a whole body is drawn as a single textured quad and
+// all cached creatures share one SDL_RenderGeometry call.
+class SpriteCache {
+public:
+    static constexpr int ATLAS_SIZE = 1024;
+    static constexpr int PADDING = 2;
+
+    SpriteCache(Renderer* renderer) : renderer_(renderer) {}
+
+    // Re-bakes root if it has no slot yet or its static subtree was edited.
+    // Returns false if the creature can't be cached (too large, no render targets).
+    bool bake(Entity* root);
+    // True if bake(root) would draw the creature again (reads the tree's positions)
+    bool needsBake(Entity* root) const;
+    void collectSprite(Entity* root, RenderData& data) const;
+    void release(Entity* root);
+    // Destroys the atlas, must be called before the SDL renderer is destroyed.
+    void clear();
+
+    SDL_Texture* getAtlas() const { return atlas_; }
+
+private:
+    Renderer* renderer_;
+    SDL_Texture* atlas_ = nullptr;
+    int shelfX_ = 0;
+    int shelfY_ = 0;
+    int shelfHeight_ = 0;
+    std::unordered_map<Entity*, SDL_FRect> slots_;
+    RenderData bakeData_;
+
+    bool createAtlas();
+    bool allocate(int w, int h, SDL_FRect& out);
+    void reset();
+};
+
+#endif // SPRITE_CACHE_H